@@ -0,0 +1,565 @@
+// Log analyzer, computes statistics of output.txt of the emulator without loading it into Python.
+//
+// Usage: Log_analyzer <output.txt> [--csv <path>] [--json <path>] [--threads <n>]
+// Without --csv and --json, the CSV is written to the standard output.
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace
+{
+    // Kind of statistics, values are:
+    // state, flow - durations of begin-end logs,
+    // port, event - gaps between logs (sorted by time).
+    enum Stat_kind
+    {
+        stat_state,
+        stat_flow,
+        stat_port,
+        stat_event
+    };
+    const char *stat_kind_names[] = {"state", "flow", "port", "event"};
+
+    struct Stat_key
+    {
+        Stat_kind kind;
+        std::string pid, track, name;
+        bool operator<(const Stat_key &other) const
+        {
+            if (kind != other.kind)
+                return kind < other.kind;
+            if (pid != other.pid)
+                return pid < other.pid;
+            if (track != other.track)
+                return track < other.track;
+            return name < other.name;
+        }
+    };
+
+    struct Component_summary
+    {
+        unsigned long long logs = 0;
+        long long first = 0, last = 0;
+    };
+
+    // Logs dropped by the emulator (log memory limit), gaps and durations around them are incomplete.
+    struct Drop
+    {
+        unsigned long long count = 0;
+        long long first = 0, last = 0;
+    };
+
+    // Statistics of one chunk of the log, chunks are merged after parsing.
+    struct Chunk_result
+    {
+        std::map<Stat_key, std::vector<long long>> samples;
+        std::map<std::string, Component_summary> components;
+        std::string log_filter;
+        std::vector<Drop> drops;
+        unsigned long long malformed = 0;
+    };
+
+    struct Stat
+    {
+        unsigned long long count = 0; // logs (gaps are count - 1)
+        long long min = 0, max = 0, p50 = 0, p90 = 0, p99 = 0, p999 = 0;
+        double mean = 0, stddev = 0, residency = -1; // residency only for states
+    };
+
+    // Read-only view of the log file.
+    class Mapped_file
+    {
+        const char *data_ = nullptr;
+        size_t size_ = 0;
+#ifdef _WIN32
+        HANDLE file = INVALID_HANDLE_VALUE, mapping = nullptr;
+#else
+        int fd = -1;
+#endif
+    public:
+        bool open(const std::string &path)
+        {
+#ifdef _WIN32
+            file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file == INVALID_HANDLE_VALUE)
+                return false;
+            LARGE_INTEGER fileSize;
+            if (!GetFileSizeEx(file, &fileSize))
+                return false;
+            size_ = static_cast<size_t>(fileSize.QuadPart);
+            if (size_ == 0)
+                return true;
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (!mapping)
+                return false;
+            data_ = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            return data_ != nullptr;
+#else
+            fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                return false;
+            struct stat fileStat;
+            if (fstat(fd, &fileStat) != 0)
+                return false;
+            size_ = static_cast<size_t>(fileStat.st_size);
+            if (size_ == 0)
+                return true;
+            void *mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED)
+                return false;
+            madvise(mapped, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const char *>(mapped);
+            return true;
+#endif
+        }
+        ~Mapped_file()
+        {
+#ifdef _WIN32
+            if (data_)
+                UnmapViewOfFile(data_);
+            if (mapping)
+                CloseHandle(mapping);
+            if (file != INVALID_HANDLE_VALUE)
+                CloseHandle(file);
+#else
+            if (data_)
+                munmap(const_cast<char *>(data_), size_);
+            if (fd >= 0)
+                close(fd);
+#endif
+        }
+        const char *data() const { return data_; }
+        size_t size() const { return size_; }
+    };
+
+    struct Line
+    {
+        const char *begin, *end;
+    };
+
+    /**
+     * @brief Reads the next line (without the new line character).
+     *
+     * @return false at the end of the range.
+     */
+    bool nextLine(const char *&pos, const char *end, Line &line)
+    {
+        if (pos >= end)
+            return false;
+        const char *newLine = static_cast<const char *>(memchr(pos, '\n', end - pos));
+        line.begin = pos;
+        line.end = newLine ? newLine : end;
+        pos = newLine ? newLine + 1 : end;
+        if (line.end > line.begin && line.end[-1] == '\r')
+            --line.end;
+        return true;
+    }
+
+    /**
+     * @brief Returns the value of a line in the form "key: value" (trailing spaces are removed).
+     *
+     * @return false if the line doesn't start with the key.
+     */
+    bool lineValue(const Line &line, const char *key, std::string &value)
+    {
+        size_t keySize = strlen(key);
+        if (static_cast<size_t>(line.end - line.begin) < keySize || memcmp(line.begin, key, keySize) != 0)
+            return false;
+        const char *begin = line.begin + keySize, *end = line.end;
+        while (begin < end && *begin == ' ')
+            ++begin;
+        while (end > begin && end[-1] == ' ')
+            --end;
+        value.assign(begin, end);
+        return true;
+    }
+
+    /**
+     * @brief Converts time of a log to nanoseconds.
+     *
+     * Time is in the form HH:MM:SS:microseconds (nanoseconds since midnight are returned)
+     * or nanoseconds since the epoch (--log-time epoch).
+     *
+     * @return false if the time is empty or invalid.
+     */
+    bool parseTime(const std::string &time, long long &ns)
+    {
+        if (time.empty())
+            return false;
+        if (time.find(':') == std::string::npos)
+        {
+            char *end;
+            ns = strtoll(time.c_str(), &end, 10);
+            return *end == '\0';
+        }
+        unsigned int hours, minutes, seconds;
+        unsigned long long micro;
+        if (sscanf(time.c_str(), "%u:%u:%u:%llu", &hours, &minutes, &seconds, &micro) != 4)
+            return false;
+        ns = ((hours * 60LL + minutes) * 60 + seconds) * 1000000000LL + static_cast<long long>(micro) * 1000;
+        return true;
+    }
+
+    std::vector<std::string> split(const std::string &value)
+    {
+        std::vector<std::string> parts;
+        size_t begin = 0;
+        while (begin < value.size())
+        {
+            size_t end = value.find(' ', begin);
+            if (end == std::string::npos)
+                end = value.size();
+            if (end > begin)
+                parts.push_back(value.substr(begin, end - begin));
+            begin = end + 1;
+        }
+        return parts;
+    }
+
+    /**
+     * @brief Parses logs of a chunk (the chunk starts at the first line of a log).
+     *
+     * Logs are grouped like in python-test/main.py: states by FSM, flows by the FSM which controls them,
+     * sent packets by port and FSM, received packets by port and events by component.
+     */
+    void parseChunk(const char *begin, const char *end, Chunk_result &result)
+    {
+        const char *pos = begin;
+        Line line;
+        std::string name, ts, pid, cat, args, endTime;
+        while (nextLine(pos, end, line))
+        {
+            if (line.begin == line.end)
+                continue; // blank line between logs
+            Line lines[5];
+            bool complete = lineValue(line, "name:", name);
+            for (int i = 0; i < 5 && complete; ++i)
+                complete = nextLine(pos, end, lines[i]);
+            if (!complete || !lineValue(lines[0], "ts:", ts) || !lineValue(lines[1], "pid:", pid) ||
+                !lineValue(lines[2], "cat:", cat) || !lineValue(lines[3], "args:", args) ||
+                !lineValue(lines[4], "end:", endTime))
+            {
+                ++result.malformed;
+                continue;
+            }
+            if (cat == "meta")
+            {
+                Drop drop;
+                if (name == "log_filter")
+                    result.log_filter = args;
+                else if (name == "dropped_logs" && parseTime(ts, drop.first) && parseTime(endTime, drop.last))
+                {
+                    drop.count = strtoull(args.c_str(), nullptr, 10);
+                    result.drops.push_back(drop);
+                }
+                continue;
+            }
+            long long start;
+            if (!parseTime(ts, start))
+            {
+                ++result.malformed;
+                continue;
+            }
+            Component_summary &component = result.components[pid];
+            if (component.logs == 0 || start < component.first)
+                component.first = start;
+            component.last = std::max(component.last, start);
+            ++component.logs;
+
+            std::vector<std::string> argv = split(args), catv = split(cat);
+            long long stop;
+            if (cat == "state")
+            {
+                if (!argv.empty() && parseTime(endTime, stop))
+                    result.samples[Stat_key{stat_state, pid, name, argv[0]}].push_back(stop - start);
+            }
+            else if (cat == "port flow")
+            {
+                if (argv.size() > 1 && parseTime(endTime, stop))
+                    result.samples[Stat_key{stat_flow, pid, argv[1], name}].push_back(stop - start);
+            }
+            else if (catv.size() == 3 && catv[0] == "port" && catv[1] == "packet")
+            {
+                std::string port = name + "(" + (argv.empty() ? "" : argv[0]) + ")";
+                std::string track = catv[2] == "packet_snd" && argv.size() > 1 ? argv[1] : "Server";
+                result.samples[Stat_key{stat_port, pid, port, track}].push_back(start);
+            }
+            else if (catv.size() == 3 && catv[0] == "event")
+                result.samples[Stat_key{stat_event, pid, catv[1] + " " + catv[2], name}].push_back(start);
+        }
+    }
+
+    /**
+     * @brief Returns the value at the percentile of sorted values (nearest rank).
+     */
+    long long percentile(const std::vector<long long> &sorted, double p)
+    {
+        size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+        return sorted[rank == 0 ? 0 : rank - 1];
+    }
+
+    /**
+     * @brief Computes statistics of samples (timestamps are replaced by gaps between them).
+     */
+    Stat computeStat(Stat_kind kind, std::vector<long long> &values)
+    {
+        Stat stat;
+        stat.count = values.size();
+        std::sort(values.begin(), values.end());
+        if (kind == stat_port || kind == stat_event)
+        {
+            for (size_t i = 1; i < values.size(); ++i)
+                values[i - 1] = values[i] - values[i - 1];
+            values.pop_back();
+            std::sort(values.begin(), values.end());
+        }
+        if (values.empty())
+            return stat;
+        double sum = 0, squares = 0;
+        for (long long value : values)
+            sum += value;
+        stat.mean = sum / values.size();
+        for (long long value : values)
+            squares += (value - stat.mean) * (value - stat.mean);
+        stat.stddev = std::sqrt(squares / values.size());
+        stat.min = values.front();
+        stat.max = values.back();
+        stat.p50 = percentile(values, 50);
+        stat.p90 = percentile(values, 90);
+        stat.p99 = percentile(values, 99);
+        stat.p999 = percentile(values, 99.9);
+        return stat;
+    }
+
+    std::string csvField(const std::string &value)
+    {
+        if (value.find_first_of(",\"") == std::string::npos)
+            return value;
+        std::string quoted = "\"";
+        for (char c : value)
+            quoted += c == '"' ? "\"\"" : std::string(1, c);
+        return quoted + "\"";
+    }
+
+    std::string jsonString(const std::string &value)
+    {
+        std::string escaped = "\"";
+        for (char c : value)
+        {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
+            escaped += c;
+        }
+        return escaped + "\"";
+    }
+
+    void writeCsv(std::ostream &out, const std::vector<std::pair<Stat_key, Stat>> &stats)
+    {
+        out << "kind,pid,track,name,count,min_ns,max_ns,mean_ns,stddev_ns,p50_ns,p90_ns,p99_ns,p999_ns,residency\n";
+        for (const auto &entry : stats)
+        {
+            const Stat &s = entry.second;
+            out << stat_kind_names[entry.first.kind] << ',' << csvField(entry.first.pid) << ',' << csvField(entry.first.track) << ','
+                << csvField(entry.first.name) << ',' << s.count << ',' << s.min << ',' << s.max << ',' << std::fixed
+                << std::setprecision(1) << s.mean << ',' << s.stddev << ',' << s.p50 << ',' << s.p90 << ',' << s.p99 << ','
+                << s.p999 << ',';
+            if (s.residency >= 0)
+                out << std::setprecision(6) << s.residency;
+            out << '\n';
+        }
+    }
+
+    void writeJson(std::ostream &out, const std::vector<std::pair<Stat_key, Stat>> &stats,
+                   const std::map<std::string, Component_summary> &components, const std::string &log_filter,
+                   const std::vector<Drop> &drops)
+    {
+        out << "{\n\"log_filter\": " << (log_filter.empty() ? "null" : jsonString(log_filter)) << ",\n\"dropped_logs\": [";
+        bool first = true;
+        for (const auto &drop : drops)
+        {
+            out << (first ? "\n" : ",\n") << "  {\"count\": " << drop.count << ", \"first_ns\": " << drop.first
+                << ", \"last_ns\": " << drop.last << "}";
+            first = false;
+        }
+        out << (drops.empty() ? "" : "\n") << "],\n\"components\": [";
+        first = true;
+        for (const auto &component : components)
+        {
+            out << (first ? "\n" : ",\n") << "  {\"pid\": " << jsonString(component.first) << ", \"logs\": " << component.second.logs
+                << ", \"first_ns\": " << component.second.first << ", \"last_ns\": " << component.second.last << "}";
+            first = false;
+        }
+        out << "\n],\n\"stats\": [";
+        first = true;
+        for (const auto &entry : stats)
+        {
+            const Stat &s = entry.second;
+            out << (first ? "\n" : ",\n") << "  {\"kind\": \"" << stat_kind_names[entry.first.kind] << "\", \"pid\": "
+                << jsonString(entry.first.pid) << ", \"track\": " << jsonString(entry.first.track) << ", \"name\": "
+                << jsonString(entry.first.name) << ", \"count\": " << s.count << ", \"min_ns\": " << s.min << ", \"max_ns\": "
+                << s.max << ", \"mean_ns\": " << std::fixed << std::setprecision(1) << s.mean << ", \"stddev_ns\": " << s.stddev
+                << ", \"p50_ns\": " << s.p50 << ", \"p90_ns\": " << s.p90 << ", \"p99_ns\": " << s.p99 << ", \"p999_ns\": " << s.p999;
+            if (s.residency >= 0)
+                out << ", \"residency\": " << std::setprecision(6) << s.residency;
+            out << "}";
+            first = false;
+        }
+        out << "\n]\n}\n";
+    }
+}
+
+int main(int argc, char const *argv[])
+{
+    if (argc < 2)
+    {
+        std::cout << "WRITE PATH TO LOG FILE (output.txt) [--csv <path>] [--json <path>] [--threads <n>]" << std::endl;
+        return -1;
+    }
+    std::string csvPath, jsonPath;
+    unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 2; i + 1 < argc; i += 2)
+    {
+        std::string option = argv[i];
+        if (option == "--csv")
+            csvPath = argv[i + 1];
+        else if (option == "--json")
+            jsonPath = argv[i + 1];
+        else if (option == "--threads")
+            threads = std::max(1ul, std::strtoul(argv[i + 1], nullptr, 10));
+        else
+            std::cerr << "UNKNOWN OPTION " << option << std::endl;
+    }
+
+    Mapped_file file;
+    if (!file.open(argv[1]))
+    {
+        std::cerr << "Unable to open file " << argv[1] << std::endl;
+        return -1;
+    }
+
+    // Split the file into chunks starting at the first line of a log (after a blank line).
+    const char *data = file.data(), *dataEnd = file.data() + file.size();
+    std::vector<const char *> bounds{data};
+    for (unsigned int i = 1; i < threads && file.size() > 0; ++i)
+    {
+        const char *pos = std::max(bounds.back(), data + file.size() / threads * i);
+        const char *blank = nullptr;
+        while (pos + 1 < dataEnd && !blank)
+        {
+            const char *newLine = static_cast<const char *>(memchr(pos, '\n', dataEnd - pos - 1));
+            if (!newLine)
+                break;
+            if (newLine[1] == '\n')
+                blank = newLine + 2;
+            else if (newLine[1] == '\r' && newLine + 2 < dataEnd && newLine[2] == '\n')
+                blank = newLine + 3;
+            pos = newLine + 1;
+        }
+        if (!blank)
+            break;
+        bounds.push_back(blank);
+    }
+    bounds.push_back(dataEnd);
+
+    std::vector<Chunk_result> results(bounds.size() - 1);
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i + 1 < bounds.size(); ++i)
+        workers.emplace_back(parseChunk, bounds[i], bounds[i + 1], std::ref(results[i]));
+    for (auto &worker : workers)
+        worker.join();
+
+    // Merge chunks
+    Chunk_result merged;
+    for (auto &result : results)
+    {
+        for (auto &samples : result.samples)
+        {
+            auto &target = merged.samples[samples.first];
+            target.insert(target.end(), samples.second.begin(), samples.second.end());
+        }
+        for (const auto &component : result.components)
+        {
+            Component_summary &target = merged.components[component.first];
+            if (target.logs == 0 || component.second.first < target.first)
+                target.first = component.second.first;
+            target.last = std::max(target.last, component.second.last);
+            target.logs += component.second.logs;
+        }
+        if (!result.log_filter.empty())
+            merged.log_filter = result.log_filter;
+        merged.drops.insert(merged.drops.end(), result.drops.begin(), result.drops.end());
+        merged.malformed += result.malformed;
+        result = Chunk_result();
+    }
+    if (merged.malformed)
+        std::cerr << merged.malformed << " malformed logs skipped" << std::endl;
+    std::sort(merged.drops.begin(), merged.drops.end(), [](const Drop &a, const Drop &b) { return a.first < b.first; });
+    for (const auto &drop : merged.drops)
+        std::cerr << drop.count << " logs were dropped by the emulator (log memory limit) between " << drop.first << " and "
+                  << drop.last << " ns, statistics of this time are incomplete" << std::endl;
+
+    // Statistics of groups are independent, so they are computed in parallel too.
+    std::vector<std::pair<Stat_key, std::vector<long long> *>> groups;
+    for (auto &samples : merged.samples)
+        groups.push_back({samples.first, &samples.second});
+    std::vector<std::pair<Stat_key, Stat>> stats(groups.size());
+    workers.clear();
+    for (unsigned int t = 0; t < threads && t < groups.size(); ++t)
+        workers.emplace_back([&groups, &stats, t, threads]() {
+            for (size_t i = t; i < groups.size(); i += threads)
+                stats[i] = {groups[i].first, computeStat(groups[i].first.kind, *groups[i].second)};
+        });
+    for (auto &worker : workers)
+        worker.join();
+
+    // State residency: share of the time of the FSM spent in the state.
+    std::map<std::pair<std::string, std::string>, double> fsmTimes;
+    for (const auto &entry : stats)
+        if (entry.first.kind == stat_state)
+            fsmTimes[{entry.first.pid, entry.first.track}] += entry.second.mean * entry.second.count;
+    for (auto &entry : stats)
+        if (entry.first.kind == stat_state)
+        {
+            double total = fsmTimes[{entry.first.pid, entry.first.track}];
+            entry.second.residency = total > 0 ? entry.second.mean * entry.second.count / total : 0;
+        }
+
+    if (csvPath.empty() && jsonPath.empty())
+        writeCsv(std::cout, stats);
+    if (!csvPath.empty())
+    {
+        std::ofstream csv(csvPath);
+        if (!csv.is_open())
+        {
+            std::cerr << "Unable to open file " << csvPath << std::endl;
+            return -1;
+        }
+        writeCsv(csv, stats);
+    }
+    if (!jsonPath.empty())
+    {
+        std::ofstream json(jsonPath);
+        if (!json.is_open())
+        {
+            std::cerr << "Unable to open file " << jsonPath << std::endl;
+            return -1;
+        }
+        writeJson(json, stats, merged.components, merged.log_filter, merged.drops);
+    }
+    return 0;
+}
@@ -27,24 +27,8 @@ public:
      */
     void message_arrived(mqtt::const_message_ptr msg) override
     {
-        
-        std::shared_ptr<Event> eventPointer;
-        std::vector<std::string> cat;
         auto comp =Component::getComponent(c_name); // takes component ptr from c_name(related to callback)
-        if(eventPointer = comp->mgetEvent(msg->get_topic())){ //Takes event ptr by mqtt_topic
-            if (eventPointer->getType() == E_type::io || eventPointer->getType() == E_type::i)
-                cat = {"event", "app", "event_rcv"};
-            else if (eventPointer->getType() == E_type::e)
-                cat = {"event", "env", "event_rcv"};
-            Comp_log::Comp_logCreator(
-                eventPointer->getE_name(), 
-                comp->getPid(), 
-                ph_type::I, 
-                cat
-            );
-            //Proccess event
-            comp->receiveEvent(eventPointer->getE_name());
-        }
+        comp->messageArrived(msg->get_topic());
     }
 
 
@@ -1,12 +1,20 @@
 #pragma once
 #include <fstream>
 #include <vector>
+#include <deque>
+#include <map>
 #include <atomic>
 #include <unordered_map>
+#include <unordered_set>
 #include <iomanip>
 #include <regex>
 #include <future>
+#include <functional>
+#include <thread>
 #include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
 #include <random>
 #include <mutex>
 #include <sstream>
@@ -22,9 +30,16 @@
     #include <sys/select.h>
     #include <arpa/inet.h>
     #include <unistd.h>
+    #include <fcntl.h>
+    #include <poll.h>
 #endif
 
 
+enum Time_format
+{
+    hms,
+    epoch_ns
+};
 enum ph_type
 {
     I,
@@ -53,5 +68,15 @@ enum Transport_type
 enum Flow_type
 {
     simple,
-    on_off
+    on_off,
+    poisson,     // exponential times between packets
+    burst,       // packets back-to-back every interval
+    token_bucket, // poisson packets shaped by a token bucket
+    replay        // packets of a pcap capture
+};
+enum Size_distribution
+{
+    size_fixed,
+    size_uniform,
+    size_exponential
 };
\ No newline at end of file
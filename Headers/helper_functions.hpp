@@ -40,6 +40,23 @@ namespace Helper_functions
         }
     }
 
+    /**
+     * @brief Reads the decimal number at the start of a buffer.
+     *
+     * Clients of the emulator write a random value at the start of every packet.
+     *
+     * @param data The buffer.
+     * @param size The size of the buffer.
+     * @return The number (at most 18 digits are read), or 0 if the buffer doesn't start with a digit.
+     */
+    inline long long leadingNumber(const char *data, size_t size)
+    {
+        long long value = 0;
+        for (size_t i = 0; i < size && i < 18 && data[i] >= '0' && data[i] <= '9'; ++i)
+            value = value * 10 + (data[i] - '0');
+        return value;
+    }
+
     /**
      * @brief Retrieves an object from a unordered map container by name.
      *
@@ -1,23 +1,80 @@
 #pragma once
 #include "../../Headers/headers.hpp"
 
+// Fixed-size log, strings are kept as interned ids and materialized only by the writer.
 class Comp_log
 {
 public:
-    std::string name, ts, end;
-    unsigned int pid;
-    ph_type ph_value;
-    std::vector<std::string> cat, args;
-    static std::mutex mtx;
-
-    Comp_log(const std::string &, const std::string &, const unsigned int &, 
-            const ph_type &,const std::vector<std::string> &,
-            const std::vector<std::string> & args = {});
-    static std::vector<std::shared_ptr<Comp_log>>  full_logs;
-    static std::vector<std::shared_ptr<Comp_log>>be_logs;
-
-    static std::string getFormattedTime(const std::chrono::system_clock::time_point &currentTime);
-    static void Comp_logCreator(const std::string &name, const unsigned int &pid, 
-                                const ph_type &ph_value, const std::vector<std::string> &cat, 
-                                const std::vector<std::string> &args = {});
+    static const unsigned int MAX_ARGS = 6;
+    enum Arg_type : unsigned char
+    {
+        arg_text,   // interned string id
+        arg_number, // signed integer
+        arg_real    // double (written like std::to_string)
+    };
+    struct Arg
+    {
+        Arg_type type;
+        unsigned long long value;
+    };
+
+    long long ts, end; // raw steady clock ticks (ns), end is 0 until a begin-end log ends
+    unsigned int name, pid;
+    unsigned short cat;
+    unsigned char ph_value, argc;
+    Arg_type arg_types[MAX_ARGS];
+    unsigned long long arg_values[MAX_ARGS];
+
+    static std::mutex mtx; // guards be_logs only
+
+    // Wall clock time of the tick_anchor, taken once per run (ticks are converted to time only at export).
+    static const std::chrono::system_clock::time_point wall_anchor;
+    static const long long tick_anchor;
+
+    // Handle of an open begin-end log, returned by beginSpan and closed by endSpan.
+    struct Span
+    {
+        unsigned int slot, gen;
+        Span() : slot(-1), gen(0) {}
+        bool isOpen() const { return slot != static_cast<unsigned int>(-1); }
+    };
+
+    Comp_log() : ts(0), end(0), name(0), pid(0), cat(0), ph_value(ph_type::I), argc(0) {}
+    Comp_log(const unsigned int &, const long long &, const unsigned int &,
+            const ph_type &, const unsigned short &,
+            std::initializer_list<Arg> args = {});
+    struct Span_slot; // open begin-end log with its generation (stale handles are ignored)
+    static std::deque<Span_slot> be_logs;
+    static std::vector<unsigned int> free_slots;
+
+    // Categories used by the emulator
+    static const unsigned short cat_state, cat_flow, cat_packet_snd, cat_packet_rcv,
+                                cat_app_event_snd, cat_app_event_rcv, cat_env_event_rcv,
+                                cat_local_event_snd, cat_local_event_rcv, cat_process_name;
+
+    // Log filter, keep 1 of sampling[cat] logs of the category (0 - category is off).
+    static std::vector<unsigned int> sampling;
+    static std::string filter_description;
+    static bool setFilter(const std::string &);
+    static bool sample(const unsigned short &cat);
+
+    static unsigned int intern(const std::string &);
+    static unsigned short internCat(const std::vector<std::string> &);
+    static const std::string &getText(const unsigned int &id);
+    static const std::string &getCat(const unsigned short &id);
+    static Arg textArg(const unsigned int &id);
+    static Arg numberArg(const long long &value);
+    static Arg realArg(const double &value);
+    std::string getArg(const unsigned int &index) const;
+
+    static long long getTick();
+    static long long getEpochNs(const long long &tick);
+    static std::string getFormattedTime(const long long &ns);
+    static void Comp_logCreator(const unsigned int &name, const unsigned int &pid,
+                                const ph_type &ph_value, const unsigned short &cat,
+                                std::initializer_list<Arg> args = {});
+    static Span beginSpan(const unsigned int &name, const unsigned int &pid,
+                          const unsigned short &cat, std::initializer_list<Arg> args = {});
+    static void endSpan(Span &span);
+    static void closeSpans();
 };
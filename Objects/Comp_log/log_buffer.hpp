@@ -0,0 +1,46 @@
+#pragma once
+#include "comp_log.hpp"
+
+class Log_buffer
+{
+    static const size_t CHUNK_SIZE = 1024;
+    struct Chunk
+    {
+        Comp_log records[CHUNK_SIZE];
+        std::atomic<size_t> count;
+        std::atomic<Chunk *> next;
+        Chunk() : count(0), next(nullptr) {}
+    };
+    Chunk *head, *tail;
+    size_t read_pos;
+
+    static std::mutex registry_mtx;
+    static std::vector<std::shared_ptr<Log_buffer>> registry, free_buffers;
+
+    // Chunks are shared by every buffer, their count is limited by the resident log memory.
+    static std::mutex pool_mtx;
+    static std::condition_variable pool_cv; // a chunk was given back by the writer
+    static std::vector<Chunk *> chunk_pool;
+    static std::atomic<size_t> chunks, max_chunks;
+    static std::atomic<bool> starved; // the writer freed no chunk in time, threads don't wait until it frees one
+    static Chunk *allocChunk(bool force = false);
+    static Chunk *waitChunk();
+    static void freeChunk(Chunk *);
+
+public:
+    Log_buffer();
+    ~Log_buffer();
+    Log_buffer(const Log_buffer &) = delete;
+    Log_buffer &operator=(const Log_buffer &) = delete;
+
+    void push(Comp_log &&);
+    void drain(std::vector<Comp_log> &);
+
+    static std::atomic<unsigned long long> dropped;
+    static std::atomic<long long> first_drop, last_drop; // ticks of drops not yet written by the writer (0 - none)
+
+    static Log_buffer &local();
+    static void setMemoryLimit(size_t bytes);
+    static void release(std::shared_ptr<Log_buffer> &);
+    static void drainAll(std::vector<Comp_log> &);
+};
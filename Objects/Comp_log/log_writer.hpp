@@ -0,0 +1,44 @@
+#pragma once
+#include "log_buffer.hpp"
+
+class Log_writer
+{
+    static std::thread writer;
+    static std::mutex mtx;
+    static std::condition_variable cv;
+    static bool stopRequested, wakeRequested;
+    static std::ofstream outputFile;
+    static long long cached_second;
+    static std::string cached_time;
+    static unsigned long long written_drops; // dropped logs already marked in the output
+
+    // Chrome JSON trace (optional), tracks are numbered per component in order of appearance.
+    enum Track_kind : unsigned char
+    {
+        track_fsm,
+        track_flows,
+        track_port,
+        track_events
+    };
+    static std::ofstream traceFile;
+    static bool traceEmpty;
+    static std::map<std::tuple<unsigned int, Track_kind, unsigned int>, unsigned int> tracks;
+
+    static void run();
+    static void writeBatch(std::vector<Comp_log> &);
+    static void writeDrops();
+    static void writeTime(const long long &tick);
+    static void writeTrace(const Comp_log &);
+    static unsigned int getTrack(const Comp_log &);
+    static void writeTraceTime(const long long &tick);
+    static void writeJsonString(const std::string &);
+
+public:
+    static std::chrono::milliseconds flush_interval;
+    static Time_format time_format;
+    static std::string trace_path;
+
+    static bool start(const std::string &path, size_t max_memory);
+    static bool wake();
+    static void stop();
+};
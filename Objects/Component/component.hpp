@@ -1,9 +1,15 @@
 #pragma once
 #include "../../Headers/headers.hpp"
+#include "../Event/event.hpp"
 #include "../Flow/flow.hpp"
 #include "../FSM/fsm.hpp"
 #include "../Port/port.hpp"
 #include "../MQTT_BROKER/mqtt_broker.hpp"
+#include "../Timer_wheel/timer_wheel.hpp"
+#include "../Reactor/reactor.hpp"
+#include "../Flow_scheduler/flow_scheduler.hpp"
+#include "../Mailbox/mailbox.hpp"
+#include "../Simulator/simulator.hpp"
 
 class Component
 {
@@ -14,6 +20,10 @@ class Component
     std::unordered_map<std::string, std::shared_ptr<Port>> pnames_ports;
     std::unordered_map<std::string, std::shared_ptr<Event>> enames_events;
     std::unordered_map<std::string, std::shared_ptr<Event>> mqtttopic_events;
+    std::vector<std::shared_ptr<Event>> eids_events; // index is Event::id
+    // FSMs with a transition on the event (index is Event::id), in groups which share no actions.
+    std::vector<std::vector<std::vector<Fsm *>>> eids_fsmgroups;
+    void groupFsms();
 
 public:
     mqtt::async_client client_;
@@ -27,21 +37,54 @@ public:
     static std::unordered_map<std::string, std::shared_ptr<Component>> cnames_components;
     std::unordered_map<std::string, std::shared_ptr<Fsm>> mnames_fsms;
 
-    std::vector<std::future<void>> futures;
-    std::mutex fut_mtx;
+    Mailbox mailbox; // incoming events, processed in order on the executor
 
     static std::atomic<bool> terminateFlag;
     static std::condition_variable comp_cv;
+    static std::mutex comp_mtx; // for comp_cv and terminateFlag changes
 
-    void local_message_arrived(std::shared_ptr<Event>);
-    void receiveEvent(std::string);
-    void handleEventActions(std::string);
+    // Descriptor which becomes readable at termination (part of every wait of ports),
+    // sockets which can block a thread are shut down at termination.
+    static int wake_fd;
+    static std::mutex sockets_mtx;
+    static std::unordered_set<int> blocking_sockets;
+    static bool initWakeup();
+    static void terminate();
+    void trackSocket(int);
+    bool connectClient(int, const sockaddr_in &, const std::string &);
+
+    void local_message_arrived(Event &);
+    void receiveEvent(Event &);
+    void transitFsm(Fsm &, Event &);
+    void messageArrived(const std::string &);
+    void postEvent(std::shared_ptr<Event>);
+    void drainMailbox();
+    void printMailboxStats();
+    void printFlowStats(const Client_flow &, const Flow_stats &);
+    void handleEventActions(Event &);
     void subscribeEvents();
-    void logStateChange(std::shared_ptr<Fsm>);
+    void logStateChange(Fsm &);
     void setupServerSocket(const std::shared_ptr<Port> &, bool);
-    bool handleClient(bool ,int , const std::string &, sockaddr_in* client_addr = nullptr, socklen_t* client_len = nullptr);
+    int openServerSocket(const std::shared_ptr<Port> &, bool);
+    bool handleClient(bool ,int , const std::string &, const unsigned int &, sockaddr_in* client_addr = nullptr, socklen_t* client_len = nullptr);
+    bool dataReceived(bool, int, const std::string &, const unsigned int &, const char *, int);
+    void packetArrived(bool, const unsigned int &, const char *, int);
     void setupClientSocket(std::shared_ptr<Port>,bool);
+    bool prepareFlow(Client_flow &);
+    void nextPacket(Client_flow &);
+    void nextRecord(Client_flow &);
+    bool sendPackets(Client_flow &, std::chrono::steady_clock::time_point &, std::chrono::steady_clock::time_point, unsigned int);
+    void transmitPackets(Client_flow &, unsigned int);
+    int sendPacket(Client_flow &, const char *, size_t, const char *, size_t);
+#ifdef USE_IO_URING
+    void queuePackets(Client_flow &, unsigned int, bool);
+    void packetsSent(Client_flow &, int);
+#endif
+#ifdef __linux__
+    void reapZerocopy(Client_flow &);
+#endif
     void startFlow(std::string );
+    void startClients();
     void cleanupSocket(int &,const std::string& );
     int seconds_until(const std::string& );
 
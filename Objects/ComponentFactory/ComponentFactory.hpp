@@ -33,6 +33,14 @@ class ComponentFactory {
                                 const std::vector<std::string>& list, 
                                 const std::string& c_name, 
                                 const std::string& pid);
+        static void fsmsCompiler(const std::string& c_name,
+                                const std::string& pid);
+        static void portsCompiler(const std::string& c_name,
+                                const std::string& pid);
+        static std::vector<Event *> actionsCompiler(const std::vector<std::string>& actions,
+                                const std::string& m_name,
+                                const std::string& c_name,
+                                const std::string& pid);
         static std::unordered_map<std::string, std::shared_ptr<State>> statesCreator(const std::string& value, 
                                 const std::vector<std::string>& list, 
                                 const std::string& c_name, 
@@ -64,10 +72,15 @@ class ComponentFactory {
                                         const std::vector<std::string>& list, 
                                         const std::string& c_name, 
                                         const std::string& pid);      
-        static std::pair<Flow_type, std::vector<float>> flowanonymousCreator(const std::string& value,
-                                                                                const std::string&c_name,
-                                                                                const std::string& pid,
-                                                                                const std::string& f_name="Anonymous Flow");
+        static std::shared_ptr<Flow> flowanonymousCreator(const std::string& value,
+                                                        const std::string&c_name,
+                                                        const std::string& pid,
+                                                        const std::string& f_name="");
+        static std::shared_ptr<Flow> replayCreator(const std::string& value,
+                                                  const std::string&c_name,
+                                                  const std::string& pid,
+                                                  const std::string& f_name);
+        static bool parseSize(const std::string& value, Size_distribution& distribution, float& min, float& mean, float& max);
         static void MQTTbrokerCreator(const std::string& value, 
                                         const std::vector<std::string>& list, 
                                         const std::string& c_name, 
@@ -1,5 +1,5 @@
 #pragma once
-#include "../../Headers/headers.hpp"
+#include "../Comp_log/comp_log.hpp"
 
 class Event
 {
@@ -8,6 +8,8 @@ class Event
     int timeout;
 
 public:
+    unsigned int log_id; // interned e_name
+    unsigned int id; // index in the component (set by ComponentFactory)
     Event(std::string, int);
     Event(std::string, E_type, std::string);
 
@@ -0,0 +1,21 @@
+#pragma once
+#include "../../Headers/headers.hpp"
+
+// Process-wide pool of threads for tasks of components (socket loops, waiting for start time, local events).
+// Threads are kept after their task ends and reused, so their count is limited by the peak number of tasks
+// running at the same time instead of the number of tasks in the run.
+class Executor
+{
+    static std::mutex mtx;
+    static std::condition_variable cv;
+    static std::deque<std::function<void()>> tasks;
+    static std::vector<std::thread> threads;
+    static size_t idle;
+    static bool stopping;
+
+    static void work();
+
+public:
+    static void submit(std::function<void()> task);
+    static void stop();
+};
@@ -1,19 +1,53 @@
 #pragma once
 #include "state.hpp"
+#include "../Comp_log/comp_log.hpp"
+
+class Event;
+
 class Fsm
 {
-    std::string m_name, s_name;
-    std::mutex mtx;
+public:
+    static const unsigned int no_transition = static_cast<unsigned int>(-1);
+    // Transition of a (state, event) pair with resolved actions, target is no_transition if the event doesn't change the state.
+    struct Compiled_transition
+    {
+        unsigned int target;
+        std::vector<Event *> actions;
+    };
+    struct Compiled_state
+    {
+        std::vector<Event *> on_entry, on_exit;
+    };
+
+private:
+    std::string m_name;
     std::unordered_map<std::string, std::shared_ptr<State>> sname_statesptr;
+    std::string initial;
+    std::atomic<unsigned int> s_id;         // current state (index of states)
+    std::atomic<unsigned long long> epoch; // incremented after every state change
 
-public:
-    std::condition_variable cv;
+    // Compiled by ComponentFactory: states by id and a flat table of transitions (state id * event_count + event id).
+    std::vector<std::shared_ptr<State>> states;
+    std::vector<Compiled_state> compiled_states;
+    std::vector<Compiled_transition> table;
+    size_t event_count;
 
-    std::atomic<bool> changeRequested;
+public:
+    Comp_log::Span state_span; // begin-end log of the current state
+    unsigned int log_id; // interned m_name
     Fsm(std::string, std::unordered_map<std::string, std::shared_ptr<State>>, std::string);
 
-    std::string &getM_name(), getS_name();
-    std::mutex cv_mtx;
-    std::shared_ptr<State> getState(const std::string& );
-    void setS_name(std::string);
-};
\ No newline at end of file
+    std::string &getM_name(), &getInitial();
+    std::unordered_map<std::string, std::shared_ptr<State>> &getStates();
+    void setTable(std::vector<std::shared_ptr<State>>, std::vector<Compiled_state>, std::vector<Compiled_transition>, size_t, unsigned int);
+
+    unsigned int getS_id();
+    unsigned long long getEpoch();
+    void setS_id(unsigned int);
+    size_t getState_count();
+    State &getState(unsigned int s_id);
+    const Compiled_state &getCompiled_state(unsigned int s_id);
+    const Compiled_transition &getTransition(unsigned int s_id, unsigned int e_id);
+    bool hasTransition(unsigned int e_id);
+    std::unordered_set<Event *> getActions();
+};
@@ -1,5 +1,6 @@
 #pragma once
 #include "transition.hpp"
+#include "../Comp_log/comp_log.hpp"
 
 class State
 {
@@ -7,6 +8,8 @@ class State
     std::vector<std::string> on_entry, on_exit;
     std::unordered_map<std::string, std::shared_ptr<Transition>> ename_transitionptr;
 public:
+    unsigned int log_id; // interned s_name
+    unsigned int id; // index in the FSM (set by ComponentFactory)
     State(
         std::string, 
         std::vector<std::string>, 
@@ -16,5 +19,6 @@ public:
     std::string &getS_name();
     std::vector<std::string> &getOn_entry(), &getOn_exit();
     std::shared_ptr<Transition> getTransition(const std::string& e_name);
+    std::unordered_map<std::string, std::shared_ptr<Transition>> &getTransitions();
 
 };
\ No newline at end of file
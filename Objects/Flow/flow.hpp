@@ -1,10 +1,12 @@
 #pragma once
-#include "../../Headers/headers.hpp"
+#include "../Comp_log/comp_log.hpp"
+#include "../Trace/trace.hpp"
 class Flow
 {
     std::string f_name;
     Flow_type f_type;
     std::vector<float> f_parameters;
+    std::vector<char> payload; // immutable template of packets (zeros), packets differ only in the header
 
 public:
     Flow(Flow_type, std::vector<float>,std::string f_name = "");
@@ -12,9 +14,18 @@ public:
     static short aflow_number;
     std::string &getF_name();
     Flow_type &getF_type();
-    float integralPart;
-    float fractionalPart;
+    std::chrono::nanoseconds interval; // time between transport packets (the parameter is in milliseconds)
+    // Size of packets, the maximum size is parameter 0 (and the size of the template)
+    Size_distribution size_distribution;
+    float size_min, size_mean;
+    // Capture of replay flows (parameters: template size, 0, speed, options)
+    std::shared_ptr<Trace> trace;
+    static const unsigned int replay_loop = 1, replay_contents = 2; // options
+    static const size_t max_replay_size = 262144;
+    unsigned int log_id; // interned f_name
+    static const size_t header_size = 10; // bytes of the value at the start of a packet (digits of unsigned int)
 
 
     std::vector<float> &getF_parameters();
+    const std::vector<char> &getPayload() const;
 };
\ No newline at end of file
@@ -0,0 +1,133 @@
+#pragma once
+#include "../FSM/fsm.hpp"
+#include "../Port/port.hpp"
+#include "../Uring/uring.hpp"
+#include <queue>
+
+class Component;
+
+// Packet staged for sending: header (in Client_flow::batch) followed by the body.
+struct Packet_slice
+{
+    size_t header_size;
+    const char *body;
+    size_t body_size;
+};
+
+// Lateness of sends behind their deadlines (ns), printed at the end.
+struct Flow_stats
+{
+    unsigned long long late_count, skipped;
+    long long late_total, late_max;
+    Flow_stats() : late_count(0), skipped(0), late_total(0), late_max(0) {}
+    void merge(const Flow_stats &other)
+    {
+        late_count += other.late_count;
+        skipped += other.skipped;
+        late_total += other.late_total;
+        late_max = std::max(late_max, other.late_max);
+    }
+};
+
+// Runtime state of a client port, used only by the pacing thread which owns it.
+struct Client_flow
+{
+    Component *component;
+    std::shared_ptr<Port> port;
+    std::shared_ptr<Fsm> fsm;
+    Client_info *client_info; // owned by the port
+    int socket;
+    bool listenFlag;
+    sockaddr_in server_addr;
+
+    Flow *actualFlow;                 // Actual Flow pointer (owned by client_info)
+    unsigned long long epoch;         // epoch of the FSM when actualFlow was checked
+    Comp_log::Span flow_span;         // Log of actual flow
+    size_t size;                      // Size of the next packet (body is sent from the template of the flow)
+    std::vector<char> batch;          // headers of packets sent together (Flow::header_size bytes each)
+    std::vector<Packet_slice> packets; // packets sent together
+    const char *contents;             // data of the next packet sent as it is (replay flows), nullptr - header and template
+    size_t trace_pos;                 // next record of the capture (replay flows)
+    long long trace_ts;               // time of the previous record (ns)
+    bool gso;                         // UDP GSO works for the socket
+    bool zerocopy;                    // large TCP packets are sent with MSG_ZEROCOPY
+    unsigned long long zerocopy_pending; // MSG_ZEROCOPY sends without completion
+    bool on_state;                    // Actual state(for SIMPLE Flow always true)
+    unsigned int randomvalue, state_log_id;
+    std::chrono::nanoseconds interval; // Time between the previous and the next packet
+    std::chrono::milliseconds on_interval, off_interval;
+    std::chrono::steady_clock::time_point start; // Use to compute on/off time
+    std::minstd_rand generator;
+    std::uniform_int_distribution<unsigned int> distribution;
+    std::exponential_distribution<double> exponential; // mean 1, scaled by the flow
+    unsigned int burst_left;          // packets of the actual burst (burst flows)
+    double tokens, lag;               // tokens in the bucket, delay of the next packet behind its arrival (ns, token_bucket flows)
+
+    std::atomic<unsigned int> gen; // changed when the FSM changes state, older deadlines are skipped
+    Flow_stats stats;
+    unsigned int shard, shards;       // shard of the port sends packets shard, shard + shards, ... of the flow
+    size_t pacer;
+#ifdef USE_IO_URING
+    Uring *ring;                      // ring of the pacing thread, nullptr - packets are sent by system calls
+    std::vector<msghdr> ring_msgs;    // messages of queued packets, read by the kernel until they complete
+    std::vector<iovec> ring_iovs;
+    char ring_control[CMSG_SPACE(sizeof(uint16_t))];
+    unsigned int ring_count;          // queued packets
+    bool ring_gso, ring_failed;       // queued as one UDP GSO message, an error was printed
+#endif
+    bool closed;
+};
+
+// Sends packets of every client port from a few pacing threads.
+// Every pacing thread keeps a min-heap of next send deadlines of its ports and sleeps until the earliest one.
+// Deadlines are absolute (start of the flow + n * interval), so time spent sending and late wake ups don't add up.
+// A state change of an FSM pushes a new deadline (now) for ports controlled by the FSM, the old one is skipped.
+// In simulation mode deadlines are tasks of the simulator instead (no pacing threads).
+// UDP ports send packets due at a deadline (late ones and, if set, those within batch_window of the deadline) together.
+// With io_uring a pacing thread queues the packets of all its ports due at once and sends them with one system call.
+class Flow_scheduler
+{
+    struct Entry
+    {
+        std::chrono::steady_clock::time_point deadline;
+        Client_flow *flow;
+        unsigned int gen;
+        bool reconfigure; // check the flow of the actual state without sending a packet
+        bool operator>(const Entry &other) const { return deadline > other.deadline; }
+    };
+    struct Pacer
+    {
+        std::mutex mtx;
+        std::condition_variable cv;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+        std::thread thread;
+#ifdef USE_IO_URING
+        std::unique_ptr<Uring> ring; // packets of all ports of the pacer due at once are sent with one system call
+#endif
+    };
+    static std::mutex mtx; // guards flows, fsm_flows and pacers
+    static std::vector<std::unique_ptr<Client_flow>> flows;
+    static std::unordered_map<const Fsm *, std::vector<Client_flow *>> fsm_flows;
+    static std::vector<std::unique_ptr<Pacer>> pacers;
+    static std::atomic<size_t> next;
+    static std::atomic<bool> stopping;
+
+    static void run(Pacer &);
+    static void push(const Entry &);
+    static bool fire(const Entry &, Entry &next);
+#ifdef USE_IO_URING
+    static void flush(Pacer &);
+#endif
+
+public:
+    static unsigned int pacer_count;
+    static const unsigned int max_batch = 64; // segments of one UDP GSO send
+    static std::chrono::microseconds batch_window;
+    static size_t zerocopy_min; // TCP packets from this size are sent with MSG_ZEROCOPY (0 - off)
+    static std::chrono::microseconds spin; // the last part of a wait is busy waiting (0 - off)
+    static bool pin; // pacing thread i runs only on core i
+
+    static void add(std::unique_ptr<Client_flow>);
+    static void fsmChanged(const Fsm *);
+    static void stop();
+};
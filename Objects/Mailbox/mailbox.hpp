@@ -0,0 +1,32 @@
+#pragma once
+#include "../Event/event.hpp"
+
+// Queue of events of a component: many producers (MQTT callback, timers), one consumer at a time.
+// Push is lock-free (intrusive MPSC queue), the consumer is scheduled by the producer which makes `depth` non-zero.
+class Mailbox
+{
+    struct Node
+    {
+        std::shared_ptr<Event> event;
+        long long enqueued; // tick
+        std::atomic<Node *> next;
+    };
+    std::atomic<Node *> head; // last pushed node
+    Node *tail;               // next node to pop (consumer only)
+    Node stub;
+
+    void pushNode(Node *);
+
+public:
+    std::atomic<size_t> depth, max_depth;
+    std::atomic<unsigned long long> processed, total_latency, max_latency; // latency in ns from push to processed
+
+    Mailbox();
+    ~Mailbox();
+    Mailbox(const Mailbox &) = delete;
+    Mailbox &operator=(const Mailbox &) = delete;
+
+    bool push(std::shared_ptr<Event>);
+    std::shared_ptr<Event> pop(long long &enqueued);
+    bool processedOne(const long long &enqueued);
+};
@@ -5,11 +5,16 @@ class Client_info
 {
     std::string remote_IP, m_name;
     int remote_port;
+    unsigned int parallelism; // sockets (and pacing threads) sharing the flow
     std::unordered_map<std::string,std::shared_ptr<Flow>> sname_flow;
+    std::vector<std::shared_ptr<Flow>> sid_flows; // index is the state id of the FSM (set by ComponentFactory)
 
 public:
-    Client_info(std::string, int, std::string, std::unordered_map<std::string,  std::shared_ptr<Flow>>);
+    Client_info(std::string, int, std::string, std::unordered_map<std::string,  std::shared_ptr<Flow>>, unsigned int parallelism = 1);
     std::string &getRemote_IP(), &getM_name();
     int &getRemote_port();
+    unsigned int getParallelism() const;
     std::shared_ptr<Flow> getFlow(const std::string&);
+    Flow *getFlow(unsigned int s_id);
+    void setState_flows(std::vector<std::shared_ptr<Flow>>);
 };
\ No newline at end of file
@@ -11,6 +11,7 @@ class Port
     std::shared_ptr<Client_info> client_infoptr;
 
 public:
+    unsigned int log_id; // interned p_name
     Port(std::string, Port_type, Transport_type, std::string, int, std::shared_ptr<Client_info> client_infoptr = nullptr);
 
     std::string &getP_name(), &getLocal_IP() ;
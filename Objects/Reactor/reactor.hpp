@@ -0,0 +1,54 @@
+#pragma once
+#include "../../Headers/headers.hpp"
+#include "../Uring/uring.hpp"
+
+#ifdef __linux__
+// Event loops (one per core) which own server sockets and accepted TCP connections (Linux, epoll or io_uring).
+// Handlers are run on the thread of the reactor which owns the socket, so they must not block.
+// With io_uring a socket has one multishot request (accept or receive into buffers registered by the reactor),
+// so a reactor waits for and handles completions of all its sockets with one system call.
+class Reactor
+{
+    struct Handler
+    {
+        std::function<bool()> on_readable;             // false - the socket was closed by the handler (epoll)
+        std::function<bool(const char *, int)> on_data; // received data, 0 - closed by the peer, < 0 - error
+        std::function<void(int)> on_accept;            // accepted connection or -1
+        std::function<void()> on_close;                // closes the socket when the reactor stops or the socket fails
+        unsigned int id;                               // request of the socket (io_uring)
+    };
+    int epoll_fd, wake_fd;
+    std::thread thread;
+    std::mutex mtx;
+    std::unordered_map<int, std::shared_ptr<Handler>> handlers;
+#ifdef USE_IO_URING
+    std::unique_ptr<Uring> ring;
+    std::vector<std::pair<int, std::shared_ptr<Handler>>> added; // armed by the reactor thread (owner of the ring)
+    bool multishot; // multishot receive (Linux 6.0+), otherwise a receive is armed again after every completion
+    static std::atomic<unsigned int> next_id;
+
+    void arm(int fd, const Handler &handler);
+    void runRing();
+#endif
+
+    static std::once_flag reactors_flag;
+    static std::vector<std::unique_ptr<Reactor>> reactors;
+    static std::atomic<unsigned int> next;
+    static std::atomic<bool> stopping;
+
+    Reactor();
+    void run();
+    void remove(int fd, const std::shared_ptr<Handler> &handler);
+    static void add(int fd, std::shared_ptr<Handler> handler, size_t reactor);
+
+public:
+    ~Reactor();
+    static bool reuseport;
+    static const size_t buffer_size = 1024; // received data of one call, longer datagrams are truncated
+
+    static size_t count();
+    static void receive(int fd, std::function<bool(const char *, int)> on_data, std::function<void()> on_close, size_t reactor = -1);
+    static void accept(int fd, std::function<void(int)> on_accept, std::function<void()> on_close, size_t reactor = -1);
+    static void stop();
+};
+#endif
@@ -0,0 +1,47 @@
+#pragma once
+#include "../../Headers/headers.hpp"
+#include <queue>
+#include <tuple>
+
+// Discrete-event simulation (`--sim`): every task of the emulator runs on one thread in virtual time,
+// packets of ports and MQTT messages are delivered in memory.
+// The virtual clock jumps to the next scheduled task, so a run takes only the time the tasks need.
+class Simulator
+{
+    struct Task
+    {
+        long long at;           // virtual tick (ns, same scale as Comp_log::getTick)
+        unsigned long long seq; // tasks with the same time run in the order they were scheduled
+        std::function<void()> task;
+        bool operator>(const Task &other) const { return at != other.at ? at > other.at : seq > other.seq; }
+    };
+    static std::mutex mtx; // guards queue, topics and listeners
+    static std::priority_queue<Task, std::vector<Task>, std::greater<Task>> queue;
+    static unsigned long long seq;
+    static std::atomic<long long> tick;
+    static long long end;
+
+    static std::unordered_map<std::string, std::vector<std::function<void()>>> topics;
+    static std::map<std::tuple<bool, uint32_t, uint16_t>, std::function<void(const char *, int)>> listeners;
+    static std::vector<std::pair<long long, std::string>> environment; // messages of the environment (ns after start, topic)
+
+public:
+    static bool enabled;
+    static long long duration; // ns of virtual time the emulation runs after the start time
+
+    static void enable();
+    static long long now();
+    static std::chrono::steady_clock::time_point steadyNow();
+    static void schedule(long long at, std::function<void()> task);
+    static bool setEnvironment(const std::string &);
+    static void startRun();
+    static void run();
+
+    // In-process MQTT bus
+    static void subscribe(const std::string &topic, std::function<void()> on_message);
+    static void publish(const std::string &topic);
+
+    // In-memory transport
+    static void listen(bool tcp, const std::string &ip, int port, std::function<void(const char *, int)> on_packet);
+    static bool send(bool tcp, const sockaddr_in &addr, const char *data, int size);
+};
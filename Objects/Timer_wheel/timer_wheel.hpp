@@ -0,0 +1,33 @@
+#pragma once
+#include "../Executor/executor.hpp"
+
+// Hierarchical timer wheel with millisecond ticks, driven by one thread (used by local events).
+// Level 0 has a slot per millisecond of the next 64 ms, every next level covers 64 times longer time,
+// timers are moved to lower levels when the lower level wraps around.
+class Timer_wheel
+{
+    static const unsigned int LEVELS = 4, SLOT_BITS = 6, SLOTS = 1 << SLOT_BITS;
+    struct Timer
+    {
+        long long expires; // tick of the wheel
+        std::function<void(bool)> callback;
+    };
+    static std::vector<Timer> wheel[LEVELS][SLOTS];
+    static size_t pending;
+    static long long current; // last processed tick
+    static const std::chrono::steady_clock::time_point origin;
+
+    static std::thread timer_thread;
+    static std::mutex mtx;
+    static std::condition_variable cv;
+    static bool stopped;
+
+    static void run();
+    static void insert(Timer &&);
+    static void advance(std::vector<Timer> &due);
+    static long long nextTick();
+
+public:
+    static void schedule(const unsigned long long &ms, std::function<void(bool)> callback);
+    static void stop();
+};
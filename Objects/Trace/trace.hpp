@@ -0,0 +1,45 @@
+#pragma once
+#include "../../Headers/headers.hpp"
+
+// Packet capture (pcap) replayed by `replay` flows.
+// The file is memory-mapped and read sequentially by cursors of ports, pages behind a cursor are released,
+// so captures larger than the memory can be replayed. The mapping is read-only and shared by every port.
+class Trace
+{
+    const char *data;
+    size_t size;
+    size_t snaplen;
+    unsigned int linktype;
+    bool swapped;     // byte order of the capture is different from the host
+    bool nanoseconds; // timestamps are in nanoseconds (otherwise microseconds)
+#ifdef _WIN32
+    HANDLE file, mapping;
+#else
+    int fd;
+#endif
+
+    Trace();
+    uint32_t read32(const char *) const;
+    size_t payload(const char *frame, size_t length, const char *&begin) const;
+    void release(size_t from, size_t to) const;
+
+public:
+    static const size_t header_size = 24, record_header_size = 16;
+    static const size_t release_chunk = 64 * 1024 * 1024; // consumed bytes released at once
+
+    // Packet of the capture: transport payload (UDP or TCP data, whole frame for other protocols).
+    struct Record
+    {
+        long long ts; // ns
+        const char *data;
+        size_t size;
+    };
+
+    ~Trace();
+    Trace(const Trace &) = delete;
+    Trace &operator=(const Trace &) = delete;
+
+    static std::shared_ptr<Trace> open(const std::string &path, std::string &error);
+    bool next(size_t &pos, Record &) const;
+    size_t getSnaplen() const;
+};
@@ -0,0 +1,48 @@
+#pragma once
+#include "../../Headers/headers.hpp"
+
+#if defined(__linux__) && defined(USE_IO_URING)
+#include <linux/io_uring.h>
+
+// Submission and completion rings of io_uring used through system calls (no liburing), owned by one thread.
+// Optionally with a ring of provided buffers registered in the kernel, which receives pick buffers from.
+class Uring
+{
+    int ring_fd;
+    void *sq_ptr, *cq_ptr;
+    size_t sq_size, cq_size;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    io_uring_sqe *sqes;
+    io_uring_cqe *cqes;
+    unsigned sq_entries, local_tail, queued; // SQEs written after local_tail is published by submit
+
+    io_uring_buf_ring *buf_ring;
+    std::vector<char> buffers;
+    unsigned buf_count, buf_size;
+    unsigned short buf_tail;
+
+    static std::once_flag probe_flag;
+    static bool usable;
+
+public:
+    unsigned int inflight; // single-shot requests without a completion (counted by the owner)
+    static bool enabled;   // sockets use io_uring (--io-uring), cleared if the kernel doesn't support it
+    static const unsigned short buffer_group = 0;
+
+    Uring();
+    ~Uring();
+    Uring(const Uring &) = delete;
+    Uring &operator=(const Uring &) = delete;
+
+    static bool available();
+    bool init(unsigned entries, std::string &error);
+    bool provideBuffers(unsigned count, unsigned size, std::string &error);
+    io_uring_sqe *sqe();
+    int submit(unsigned wait);
+    bool completion(io_uring_cqe &cqe);
+    unsigned pending() const { return queued; }
+    const char *buffer(unsigned id) const { return buffers.data() + static_cast<size_t>(id) * buf_size; }
+    void recycle(unsigned id);
+};
+#endif
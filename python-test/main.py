@@ -2,6 +2,65 @@ from matplotlib.widgets import Button
 import numpy as np
 import matplotlib.pyplot as plt
 from datetime import datetime
+import csv
+import json
+import sys
+
+
+def parse_time(time):
+    # Time of logs is in form HH:MM:SS:microseconds or nanoseconds since the epoch (--log-time epoch)
+    if time.isdigit():
+        return datetime.fromtimestamp(int(time) / 1e9)
+    return datetime.strptime(time, '%H:%M:%S:%f')
+
+
+def load_stats(path):
+    # Statistics written by Log_analyzer (--csv or --json), times in nanoseconds
+    if path.endswith('.json'):
+        with open(path, 'r') as file:
+            data = json.load(file)
+        if data.get('log_filter'):
+            print(f"Logs were sampled: {data['log_filter']}")
+        for drop in data.get('dropped_logs', []):
+            print(f"{drop['count']} logs were dropped (log memory limit) between {drop['first_ns']} and "
+                  f"{drop['last_ns']} ns, statistics of this time are incomplete")
+        stats = data['stats']
+    else:
+        with open(path, 'r', newline='') as file:
+            stats = list(csv.DictReader(file))
+    for stat in stats:
+        for key in ('count', 'min_ns', 'max_ns', 'mean_ns', 'stddev_ns', 'p50_ns', 'p90_ns', 'p99_ns', 'p999_ns'):
+            stat[key] = float(stat[key])
+        residency = stat.get('residency')
+        stat['residency'] = float(residency) if residency not in (None, '') else None
+    return stats
+
+
+def show_stats(stats):
+    # One figure per component, one subplot per kind (state, flow, port, event) with mean ± stddev, p99 and max in ms
+    components = {}
+    for stat in stats:
+        components.setdefault(stat['pid'], {}).setdefault(stat['kind'], []).append(stat)
+    for pid, kinds in components.items():
+        fig, axs = plt.subplots(len(kinds), 1, figsize=(12, 4 * len(kinds)), squeeze=False)
+        fig.suptitle(f"Component PID: {pid}", fontsize=16)
+        print(f"Component PID: {pid}")
+        for ax, (kind, kind_stats) in zip(axs[:, 0], kinds.items()):
+            labels = [f"{stat['track']} {stat['name']}".strip() for stat in kind_stats]
+            means = [stat['mean_ns'] / 1e6 for stat in kind_stats]
+            ax.barh(labels, means, xerr=[stat['stddev_ns'] / 1e6 for stat in kind_stats], color='lightblue',
+                    edgecolor='black', label='mean ± std_dev')
+            ax.scatter([stat['p99_ns'] / 1e6 for stat in kind_stats], labels, marker='x', color='C1', label='p99')
+            ax.scatter([stat['max_ns'] / 1e6 for stat in kind_stats], labels, marker='|', s=200, color='C3', label='max')
+            for label, mean, stat in zip(labels, means, kind_stats):
+                if stat['residency'] is not None:
+                    ax.text(mean, label, f" {stat['residency'] * 100:.1f}%", va='center', fontsize=8)
+                print(f" {kind} {label}: Nr: {stat['count']:.0f} Min: {stat['min_ns'] / 1e9} Max: {stat['max_ns'] / 1e9} "
+                      f"Avg: {stat['mean_ns'] / 1e9} Std_dev: {stat['stddev_ns'] / 1e9} P99: {stat['p99_ns'] / 1e9}")
+            ax.set_title(f"{kind} (durations of states and flows, gaps of ports and events)")
+            ax.set_xlabel('Time in ms')
+            ax.legend(loc='upper left', bbox_to_anchor=(1, 1))
+        fig.tight_layout()
 
 
 class Component:
@@ -22,8 +81,8 @@ class Component:
         clicked_rectangle = {}
 
         # Convert time from string format to datetime
-        times_m_dt = [datetime.strptime(time, '%H:%M:%S:%f') for time in times_m]
-        times_s_dt = [datetime.strptime(time, '%H:%M:%S:%f') for time in times_s]
+        times_m_dt = [parse_time(time) for time in times_m]
+        times_s_dt = [parse_time(time) for time in times_s]
 
         # Calculate state durations
         durations = [(times_s_dt[i] - times_m_dt[i]).total_seconds() for i in range(len(times_m))] #Duration of state
@@ -88,7 +147,7 @@ class Component:
         visible_scatter_texts = {}  # Store currently visible scatter texts
 
         # Convert times to datetime and calculate seconds from base time
-        times_m_dt = [datetime.strptime(time, '%H:%M:%S:%f') for time in times_m]
+        times_m_dt = [parse_time(time) for time in times_m]
         events = [(time - base_time_dt).total_seconds() for time in times_m_dt]
 
         scatter_texts = {}  # Store text for each scatter point
@@ -144,8 +203,7 @@ class Component:
 
         def show_data(event=None):
             # Calculate and display statistics based on visible scatter texts
-            parsed_times = [datetime.strptime(
-                time, "%H:%M:%S:%f") for time in visible_scatter_texts.values()]
+            parsed_times = [parse_time(time) for time in visible_scatter_texts.values()]
             print(title)
             print(f"Component PID: {self.pid}")
             differences = [(parsed_times[i + 1] - parsed_times[i]).total_seconds()
@@ -173,11 +231,24 @@ class Component:
         ax.callbacks.connect('xlim_changed', on_zoom)
 
 
+# python main.py --stats stats.csv (or stats.json) plots statistics of Log_analyzer instead of the raw log
+if len(sys.argv) > 2 and sys.argv[1] == '--stats':
+    show_stats(load_stats(sys.argv[2]))
+    plt.show()
+    sys.exit()
+
 with open('../build/Debug/output.txt', 'r') as file:
     lines = file.readlines()
 lines = [element.replace('\n', '') for element in lines]
 lines = [element for element in lines if element.strip()]
 lines = [lines[i:i + 6] for i in range(0, len(lines), 6)]
+for line in lines:
+    if line[3] == "cat: meta " and line[0] == "name: dropped_logs":
+        print(f"{line[4].replace('args: ', '').strip()} logs were dropped (log memory limit) between "
+              f"{line[1].replace('ts: ', '')} and {line[5].replace('end: ', '')}, plots of this time are incomplete")
+    elif line[3] == "cat: meta ":
+        print(f"Logs were sampled: {line[4].replace('args: ', '')}")
+lines = [line for line in lines if line[3] != "cat: meta "]
 for line in lines:
     pid = line[2].split()[1]
     Component.components_dict[pid] = Component(pid)
@@ -251,9 +322,9 @@ for comp in Component.components_dict.keys():
     fig.suptitle(f"Component PID: {comp}", fontsize=16)
 
     i = 0
-    min_value_dt = datetime.strptime('23:59:59:999999', '%H:%M:%S:%f')
+    min_value_dt = datetime.max
     for fsm in fsms.keys():
-        min_value = datetime.strptime(fsms[fsm][0][0], '%H:%M:%S:%f')
+        min_value = parse_time(fsms[fsm][0][0])
         if min_value < min_value_dt:
             min_value_dt = min_value
         Component.components_dict[comp].create_state_change_visualization(axs[i], fsms[fsm][0], fsms[fsm][1],
@@ -1,12 +1,25 @@
 #include "../Objects/Port/client_info.hpp"
 #include "../Headers/helper_functions.hpp"
 
-Client_info::Client_info(std::string remote_IP, int remote_port, std::string m_name, std::unordered_map<std::string,std::shared_ptr<Flow>>sname_flow) : remote_IP(std::move(remote_IP)), m_name(std::move(m_name)),remote_port(remote_port), sname_flow(std::move(sname_flow)) {}
+Client_info::Client_info(std::string remote_IP, int remote_port, std::string m_name, std::unordered_map<std::string,std::shared_ptr<Flow>>sname_flow, unsigned int parallelism) : remote_IP(std::move(remote_IP)), m_name(std::move(m_name)),remote_port(remote_port), parallelism(parallelism), sname_flow(std::move(sname_flow)) {}
 
 std::string& Client_info::getM_name() { return m_name; }
 std::string &Client_info::getRemote_IP() { return remote_IP; }
 int &Client_info::getRemote_port() { return remote_port; }
+unsigned int Client_info::getParallelism() const { return parallelism; }
 std::shared_ptr<Flow> Client_info::getFlow(const std::string& s_name){
     return Helper_functions::getObjectByName(sname_flow, s_name);
 }
  
+
+/**
+ * @brief Returns the flow of a state by the state id (used for every packet, so no lookup by name and no refcount).
+ *
+ * @return nullptr if the state has no flow.
+ */
+Flow *Client_info::getFlow(unsigned int s_id){
+    return s_id < sid_flows.size() ? sid_flows[s_id].get() : nullptr;
+}
+void Client_info::setState_flows(std::vector<std::shared_ptr<Flow>> sid_flows){
+    this->sid_flows = std::move(sid_flows);
+}
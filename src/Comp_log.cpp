@@ -1,13 +1,215 @@
-#include "../Objects/Comp_log/comp_log.hpp"
+#include "../Objects/Comp_log/log_buffer.hpp"
+#include "../Objects/Simulator/simulator.hpp"
+#include <cstring>
+#include <map>
 
+namespace
+{
+    // Interned strings of logs (names, text arguments and categories).
+    struct Log_strings
+    {
+        std::mutex mtx;
+        std::unordered_map<std::string, unsigned int> text_ids;
+        std::deque<std::string> texts;
+        std::map<std::vector<std::string>, unsigned short> cat_ids;
+        std::deque<std::string> cats; // in the form written to the output: "port packet packet_snd "
+        std::deque<std::vector<std::string>> cat_parts;
+    };
+    Log_strings &log_strings()
+    {
+        static Log_strings strings;
+        return strings;
+    }
+}
+
+struct Comp_log::Span_slot
+{
+    Comp_log log;
+    unsigned int gen;
+    bool open;
+};
 
-std::vector<std::shared_ptr<Comp_log>> Comp_log::full_logs;
-std::vector<std::shared_ptr<Comp_log>> Comp_log::be_logs;
+std::deque<Comp_log::Span_slot> Comp_log::be_logs;
+std::vector<unsigned int> Comp_log::free_slots;
 
 std::mutex Comp_log::mtx;
+std::vector<unsigned int> Comp_log::sampling;
+std::string Comp_log::filter_description;
+
+const unsigned short Comp_log::cat_state = Comp_log::internCat({"state"});
+const unsigned short Comp_log::cat_flow = Comp_log::internCat({"port", "flow"});
+const unsigned short Comp_log::cat_packet_snd = Comp_log::internCat({"port", "packet", "packet_snd"});
+const unsigned short Comp_log::cat_packet_rcv = Comp_log::internCat({"port", "packet", "packet_rcv"});
+const unsigned short Comp_log::cat_app_event_snd = Comp_log::internCat({"event", "app", "event_snd"});
+const unsigned short Comp_log::cat_app_event_rcv = Comp_log::internCat({"event", "app", "event_rcv"});
+const unsigned short Comp_log::cat_env_event_rcv = Comp_log::internCat({"event", "env", "event_rcv"});
+const unsigned short Comp_log::cat_local_event_snd = Comp_log::internCat({"event", "local", "event_snd"});
+const unsigned short Comp_log::cat_local_event_rcv = Comp_log::internCat({"event", "local", "event_rcv"});
+const unsigned short Comp_log::cat_process_name = Comp_log::internCat({"process_name"});
+
+const std::chrono::system_clock::time_point Comp_log::wall_anchor = std::chrono::system_clock::now();
+const long long Comp_log::tick_anchor = Comp_log::getTick();
+
+/**
+ * @brief Returns the id of a string used in logs (name or text argument).
+ *
+ * Objects intern their names once when they are created, so logging doesn't copy strings.
+ */
+unsigned int Comp_log::intern(const std::string &value) {
+    Log_strings &strings = log_strings();
+    std::lock_guard<std::mutex> lock(strings.mtx);
+    auto it = strings.text_ids.find(value);
+    if (it != strings.text_ids.end())
+        return it->second;
+    unsigned int id = strings.texts.size();
+    strings.texts.push_back(value);
+    strings.text_ids[value] = id;
+    return id;
+}
+
+/**
+ * @brief Returns the id of a category list (for example {"port", "packet", "packet_snd"}).
+ */
+unsigned short Comp_log::internCat(const std::vector<std::string> &cat) {
+    Log_strings &strings = log_strings();
+    std::lock_guard<std::mutex> lock(strings.mtx);
+    auto it = strings.cat_ids.find(cat);
+    if (it != strings.cat_ids.end())
+        return it->second;
+    unsigned short id = strings.cats.size();
+    std::string joined;
+    for (const auto &catValue : cat)
+        joined += catValue + " ";
+    strings.cats.push_back(joined);
+    strings.cat_parts.push_back(cat);
+    strings.cat_ids[cat] = id;
+    return id;
+}
+
+/**
+ * @brief Sets sampling of log categories (called before the emulation starts).
+ *
+ * The filter is in the form `category=ratio,...`, where category is a prefix of categories with `/` as
+ * a separator (for example `port/packet`) and ratio means that 1 of ratio logs is kept (0 - no logs).
+ * The longest matching prefix is used, categories without a rule keep every log.
+ *
+ * @param filter The filter, for example `port/packet=100,state=1`.
+ * @return false if the filter is invalid (the filter isn't changed).
+ */
+bool Comp_log::setFilter(const std::string &filter) {
+    std::vector<std::pair<std::vector<std::string>, unsigned int>> rules;
+    std::stringstream filterStream(filter);
+    std::string rule;
+    while (std::getline(filterStream, rule, ',')) {
+        size_t separator = rule.find('=');
+        if (separator == std::string::npos || separator == 0 || separator + 1 == rule.size()
+            || rule.find_first_not_of("0123456789", separator + 1) != std::string::npos)
+            return false;
+        std::vector<std::string> prefix;
+        std::stringstream prefixStream(rule.substr(0, separator));
+        std::string part;
+        while (std::getline(prefixStream, part, '/'))
+            prefix.push_back(part);
+        rules.push_back({prefix, static_cast<unsigned int>(std::stoul(rule.substr(separator + 1)))});
+    }
+
+    Log_strings &strings = log_strings();
+    std::lock_guard<std::mutex> lock(strings.mtx);
+    sampling.assign(strings.cat_parts.size(), 1);
+    for (size_t cat = 0; cat < strings.cat_parts.size(); ++cat) {
+        size_t matched = 0;
+        for (const auto &prefix : rules) {
+            const auto &parts = strings.cat_parts[cat];
+            if (prefix.first.size() > parts.size() || prefix.first.size() < matched
+                || !std::equal(prefix.first.begin(), prefix.first.end(), parts.begin()))
+                continue;
+            matched = prefix.first.size();
+            sampling[cat] = prefix.second;
+        }
+    }
+    filter_description = filter;
+    return true;
+}
+
+/**
+ * @brief Decides if a log of the category is created (counters are per thread, so no lock is needed).
+ */
+bool Comp_log::sample(const unsigned short &cat) {
+    if (cat >= sampling.size() || sampling[cat] == 1)
+        return true;
+    if (sampling[cat] == 0)
+        return false;
+    static thread_local std::vector<unsigned int> counters;
+    if (counters.size() <= cat)
+        counters.resize(sampling.size(), 0);
+    return counters[cat]++ % sampling[cat] == 0;
+}
+
+const std::string &Comp_log::getText(const unsigned int &id) {
+    Log_strings &strings = log_strings();
+    std::lock_guard<std::mutex> lock(strings.mtx);
+    return strings.texts[id];
+}
+
+const std::string &Comp_log::getCat(const unsigned short &id) {
+    Log_strings &strings = log_strings();
+    std::lock_guard<std::mutex> lock(strings.mtx);
+    return strings.cats[id];
+}
+
+Comp_log::Arg Comp_log::textArg(const unsigned int &id) {
+    return Arg{Arg_type::arg_text, id};
+}
 
-std::string Comp_log::getFormattedTime(const std::chrono::system_clock::time_point &currentTime) {
-        std::time_t currentTimeT = std::chrono::system_clock::to_time_t(currentTime);
+Comp_log::Arg Comp_log::numberArg(const long long &value) {
+    return Arg{Arg_type::arg_number, static_cast<unsigned long long>(value)};
+}
+
+Comp_log::Arg Comp_log::realArg(const double &value) {
+    Arg arg{Arg_type::arg_real, 0};
+    std::memcpy(&arg.value, &value, sizeof(value));
+    return arg;
+}
+
+/**
+ * @brief Materializes an argument of the log (used only at export).
+ */
+std::string Comp_log::getArg(const unsigned int &index) const {
+    switch (arg_types[index]) {
+        case Arg_type::arg_text:
+            return getText(static_cast<unsigned int>(arg_values[index]));
+        case Arg_type::arg_number:
+            return std::to_string(static_cast<long long>(arg_values[index]));
+        default: {
+            double value;
+            std::memcpy(&value, &arg_values[index], sizeof(value));
+            return std::to_string(value);
+        }
+    }
+}
+
+long long Comp_log::getTick() {
+    if (Simulator::enabled) // virtual time
+        return Simulator::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Converts a raw tick to nanoseconds since the epoch.
+ *
+ * The wall clock is read only once per run (anchor), so changes of the system time during the run don't move logs.
+ */
+long long Comp_log::getEpochNs(const long long &tick) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(wall_anchor.time_since_epoch()).count() + (tick - tick_anchor);
+}
+
+/**
+ * @brief Formats time in the form HH:MM:SS:microseconds (local time).
+ *
+ * @param ns Nanoseconds since the epoch.
+ */
+std::string Comp_log::getFormattedTime(const long long &ns) {
+        std::time_t currentTimeT = static_cast<std::time_t>(ns / 1000000000);
         std::tm currentTimeTM;
         #ifdef _WIN32
             localtime_s(&currentTimeTM, &currentTimeT);
@@ -17,37 +219,111 @@ std::string Comp_log::getFormattedTime(const std::chrono::system_clock::time_poi
         std::ostringstream formattedTimeStream;
         formattedTimeStream << std::put_time(&currentTimeTM, "%H:%M:%S") << ":"
                             << std::setfill('0') << std::setw(6)
-                            << std::chrono::duration_cast<std::chrono::microseconds>(currentTime.time_since_epoch()).count() % 1000000;
+                            << (ns / 1000) % 1000000;
         return formattedTimeStream.str();
     }
 
-void Comp_log::Comp_logCreator(const std::string &name, const unsigned int &pid,
-                            const ph_type &ph_value, const std::vector<std::string> &cat, 
-                            const std::vector<std::string> &args) {
+/**
+ * @brief Creates an instant or metadata log.
+ *
+ * The log is appended to the buffer of the calling thread, so no lock is shared between threads.
+ * Logs of filtered categories are discarded before the log is built.
+ * Begin-end logs are created with `beginSpan` and closed with `endSpan`.
+ */
+void Comp_log::Comp_logCreator(const unsigned int &name, const unsigned int &pid,
+                            const ph_type &ph_value, const unsigned short &cat,
+                            std::initializer_list<Arg> args) {
+    if (!sample(cat))
+        return;
+    Log_buffer::local().push(Comp_log(name, getTick(), pid, ph_value, cat, args));
+}
+
+/**
+ * @brief Opens a begin-end log.
+ *
+ * The log is stored in a free slot of `be_logs` until it is closed.
+ *
+ * @return Handle used to close the log in constant time (closed handle if the category is filtered).
+ */
+Comp_log::Span Comp_log::beginSpan(const unsigned int &name, const unsigned int &pid,
+                                   const unsigned short &cat, std::initializer_list<Arg> args) {
+    if (!sample(cat))
+        return Span();
+    Comp_log log(name, getTick(), pid, ph_type::BE, cat, args);
+    Span span;
     std::lock_guard<std::mutex> lock(mtx);
-    if (ph_value == ph_type::BE) {
-        bool found = false;
-        std::shared_ptr<Comp_log> it;
-        for (auto &log : Comp_log::be_logs) { //only be_logs search
-            if (log->pid == pid && log->name == name && log->cat == cat && log->args == args && log->end.empty()) { //IF the same log incomes, with proper type, than write end time(current)
-                log->end = getFormattedTime(std::chrono::system_clock::now());
-                found = true;
-                it = log;
-                break;
-            }
+    if (free_slots.empty()) {
+        span.slot = be_logs.size();
+        be_logs.push_back(Span_slot{std::move(log), 0, true});
+    } else {
+        span.slot = free_slots.back();
+        free_slots.pop_back();
+        be_logs[span.slot].log = std::move(log);
+        be_logs[span.slot].open = true;
+    }
+    span.gen = be_logs[span.slot].gen;
+    return span;
+}
+
+/**
+ * @brief Closes a begin-end log.
+ *
+ * The end time is written and the log is moved to the buffer of the closing thread
+ * (its ts is the begin time, so the order after merge stays the same).
+ * Closing an already closed handle does nothing.
+ *
+ * @param span Handle returned by `beginSpan`, reset after closing.
+ */
+void Comp_log::endSpan(Span &span) {
+    if (!span.isOpen())
+        return;
+    long long end = getTick();
+    Comp_log log;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        Span_slot &slot = be_logs[span.slot];
+        if (!slot.open || slot.gen != span.gen) {
+            span = Span();
+            return;
         }
-        if (!found){
-            auto comp_log = std::make_shared<Comp_log>(name, getFormattedTime(std::chrono::system_clock::now()), pid, ph_value, cat, args); //same ptr
-            Comp_log::be_logs.push_back(comp_log);
-            Comp_log::full_logs.push_back(comp_log);
-        }else
-            Comp_log::be_logs.erase(std::remove(Comp_log::be_logs.begin(), Comp_log::be_logs.end(), it), Comp_log::be_logs.end()); // to faster search remove find be
-    } else
-        Comp_log::full_logs.push_back(std::make_shared<Comp_log>(name, getFormattedTime(std::chrono::system_clock::now()), pid, ph_value, cat, args));
+        log = std::move(slot.log);
+        slot.open = false;
+        ++slot.gen;
+        free_slots.push_back(span.slot);
+    }
+    span = Span();
+    log.end = end;
+    Log_buffer::local().push(std::move(log));
 }
-Comp_log::Comp_log(const std::string &name, const std::string &ts, const unsigned int &pid, 
-            const ph_type &ph_value, const std::vector<std::string> &cat, 
-            const std::vector<std::string> &args)
-    : name(name), ts(ts), pid(pid), ph_value(ph_value), cat(cat), args(args) {}
 
+/**
+ * @brief Closes every open begin-end log with the current time as end time.
+ *
+ * Used at the end of emulation, so the writer can write logs of states and flows which are still active.
+ */
+void Comp_log::closeSpans() {
+    long long end = getTick();
+    std::lock_guard<std::mutex> lock(mtx);
+    for (size_t i = 0; i < Comp_log::be_logs.size(); ++i) {
+        Span_slot &slot = Comp_log::be_logs[i];
+        if (!slot.open)
+            continue;
+        slot.log.end = end;
+        Log_buffer::local().push(std::move(slot.log));
+        slot.open = false;
+        ++slot.gen;
+        free_slots.push_back(i);
+    }
+}
 
+Comp_log::Comp_log(const unsigned int &name, const long long &ts, const unsigned int &pid,
+            const ph_type &ph_value, const unsigned short &cat,
+            std::initializer_list<Arg> args)
+    : ts(ts), end(0), name(name), pid(pid), cat(cat), ph_value(ph_value), argc(0) {
+    for (const Arg &arg : args) {
+        if (argc == MAX_ARGS)
+            break;
+        arg_types[argc] = arg.type;
+        arg_values[argc++] = arg.value;
+    }
+}
@@ -1,10 +1,42 @@
 #include "../Headers/ReceiveCallback.hpp"
 #include "../Headers/helper_functions.hpp"
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <netinet/udp.h>
+#include <linux/errqueue.h>
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103 // linux/udp.h (glibc older than 2.29)
+#endif
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60 // asm-generic/socket.h (glibc older than 2.27)
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5 // linux/errqueue.h (kernel headers older than 4.14)
+#define SO_EE_CODE_ZEROCOPY_COPIED 1
+#endif
+
+// Errors of a UDP GSO send which mean that the kernel or the device doesn't support it (others can be transient)
+static bool gsoUnsupported(int error)
+{
+    return error == EINVAL || error == EIO || error == ENOPROTOOPT || error == EOPNOTSUPP;
+}
+#endif
 
 std::unordered_map<std::string, std::shared_ptr<Component>> Component::cnames_components;
 std::vector<std::shared_ptr<ReceiveCallback>> ReceiveCallback::activecallbacks;
 std::condition_variable Component::comp_cv;
+std::mutex Component::comp_mtx;
 std::atomic<bool> Component::terminateFlag;
+int Component::wake_fd = -1;
+std::mutex Component::sockets_mtx;
+std::unordered_set<int> Component::blocking_sockets;
+// Interned text arguments of logs
+const unsigned int log_TCP = Comp_log::intern("TCP"), log_UDP = Comp_log::intern("UDP");
+const unsigned int log_flow_types[] = {Comp_log::intern("simple"), Comp_log::intern("on_off"), Comp_log::intern("poisson"),
+                                       Comp_log::intern("burst"), Comp_log::intern("token_bucket"), Comp_log::intern("replay")}; // by Flow_type
 Component::Component(std::string c_name, unsigned int pid, 
                 std::unordered_map<std::string, std::shared_ptr<Event>> events, 
                 std::unordered_map<std::string, std::shared_ptr<Fsm>> fsms,
@@ -12,19 +44,70 @@ Component::Component(std::string c_name, unsigned int pid,
                 std::shared_ptr<MQTT_Broker> MQTT_broker,
                 std::unordered_map<std::string, std::shared_ptr<Flow>> flows) : client_(MQTT_broker->getEndpoint_IP() + ":" + MQTT_broker->getEndpoint_port(),c_name),
                 c_name(c_name),pid(pid),enames_events(std::move(events)),mnames_fsms(fsms),pnames_ports(std::move(ports)),MQTT_broker(MQTT_broker),fnames_flows(std::move(flows)) {
+    // Events by their ids (given by ComponentFactory)
+    eids_events.resize(enames_events.size());
+    for (auto &event : enames_events)
+        eids_events[event.second->id] = event.second;
+    groupFsms();
+    // Name of the component in traces
+    Comp_log::Comp_logCreator(Comp_log::intern(c_name), pid, ph_type::M, Comp_log::cat_process_name);
     for (auto &fsm : fsms) // When the component is created, log the FSM's initial state
-    {
-            Comp_log::Comp_logCreator(
-                fsm.second->getM_name(),
-                this->pid,
-                ph_type::BE, 
-                {"state"}, 
-                {fsm.second->getS_name()});
-    
-    }
+        logStateChange(*fsm.second);
 }
 unsigned int &Component::getPid() { return pid; }
 
+/**
+ * @brief Builds the index from events to FSMs with a transition on them (called once by the constructor).
+ *
+ * FSMs of an event which share an action are put into the same group (in the order of `mnames_fsms`),
+ * groups are independent and can be dispatched concurrently by `receiveEvent`.
+ */
+void Component::groupFsms()
+{
+    std::vector<Fsm *> fsms;
+    std::vector<std::unordered_set<Event *>> actions;
+    for (auto &fsm : mnames_fsms) {
+        fsms.push_back(fsm.second.get());
+        actions.push_back(fsm.second->getActions());
+    }
+    eids_fsmgroups.assign(eids_events.size(), {});
+    for (unsigned int e_id = 0; e_id < eids_events.size(); ++e_id) {
+        // Union of FSMs (indexes of fsms) with a shared action
+        std::vector<size_t> matching, group_of(fsms.size());
+        for (size_t i = 0; i < fsms.size(); ++i)
+            if (fsms[i]->hasTransition(e_id))
+                matching.push_back(i);
+        for (size_t i : matching)
+            group_of[i] = i;
+        for (size_t a = 0; a < matching.size(); ++a)
+            for (size_t b = a + 1; b < matching.size(); ++b) {
+                size_t first = matching[a], second = matching[b];
+                bool shared = false;
+                for (Event *action : actions[first])
+                    if (actions[second].count(action)) {
+                        shared = true;
+                        break;
+                    }
+                if (!shared)
+                    continue;
+                size_t from = group_of[second], to = group_of[first];
+                for (size_t i : matching)
+                    if (group_of[i] == from)
+                        group_of[i] = to;
+            }
+        std::vector<std::vector<Fsm *>> &groups = eids_fsmgroups[e_id];
+        std::unordered_map<size_t, size_t> group_index;
+        for (size_t i : matching) {
+            auto it = group_index.find(group_of[i]);
+            if (it == group_index.end()) {
+                group_index[group_of[i]] = groups.size();
+                groups.push_back({fsms[i]});
+            } else
+                groups[it->second].push_back(fsms[i]);
+        }
+    }
+}
+
 std::shared_ptr<Event> Component::egetEvent(const std::string& e_name) {
         return Helper_functions::getObjectByName(enames_events, e_name);
 }
@@ -53,153 +136,257 @@ std::shared_ptr<Fsm> Component::getFsm(const std::string& m_name) {
  * 
  * Additional info:
  * 
- * `egetEvent` retrieves a pointer from an unordered map based on the event name (action).
+ * Actions are resolved to events of the component when the FSMs are compiled.
  * 
- * `futures` is a vector containing every newly started thread in the program for all components.
+ * Local events wait for their timeout in the `Timer_wheel`.
  * 
- * @param action The name of the event to be processed.
+ * @param event The event of the action.
  */
-void Component::handleEventActions(const std::string action)
+void Component::handleEventActions(Event &event)
 {
-    std::shared_ptr<Event> eventPointer;
-
-        if (eventPointer = egetEvent(action)){
-            if (eventPointer->getType() == E_type::io || eventPointer->getType() == E_type::o)
-            {
-                try {
-                    this->client_.publish(mqtt::make_message(eventPointer->getMqtt_e_name(), action));
-                }
-                catch (const mqtt::exception& e)
-                {
-                    std::cout<<"["<<c_name <<" (" << pid << ")] MQTT publish exception event: " << eventPointer->getE_name() << std::endl;
-                }
-                Comp_log::Comp_logCreator(
-                    eventPointer->getE_name(),
-                    this->pid,
-                    ph_type::I,
-                    {"event", "app", "event_snd"}
-                );
+    if (event.getType() == E_type::io || event.getType() == E_type::o)
+    {
+        if (Simulator::enabled)
+            Simulator::publish(event.getMqtt_e_name());
+        else
+            try {
+                this->client_.publish(mqtt::make_message(event.getMqtt_e_name(), event.getE_name()));
             }
-            else if (eventPointer->getType() == E_type::l)
+            catch (const mqtt::exception& e)
             {
-                {
-                    // Starting a thread with a local event (requires protection), cannot be ended by terminateFlag.
-                    std::lock_guard<std::mutex> lock(fut_mtx);
-                    futures.push_back(std::async(std::launch::async, &Component::local_message_arrived, this,eventPointer));
-                }
-                Comp_log::Comp_logCreator(
-                    eventPointer->getE_name(),
-                    this->pid,
-                    ph_type::I,
-                    {"event", "local", "event_snd"}
-                );
+                std::cout<<"["<<c_name <<" (" << pid << ")] MQTT publish exception event: " << event.getE_name() << std::endl;
             }
-        }
+        Comp_log::Comp_logCreator(
+            event.log_id,
+            this->pid,
+            ph_type::I,
+            Comp_log::cat_app_event_snd
+        );
+    }
+    else if (event.getType() == E_type::l)
+    {
+        Event *eventPointer = &event;
+        Timer_wheel::schedule(event.getTimeout(), [this, eventPointer](bool expired) {
+            if (expired)
+                local_message_arrived(*eventPointer);
+            else
+                std::cout<<"["<<c_name <<" (" << pid << ")] Terminate local event "<< eventPointer->getE_name()<<std::endl;
+        });
+        Comp_log::Comp_logCreator(
+            event.log_id,
+            this->pid,
+            ph_type::I,
+            Comp_log::cat_local_event_snd
+        );
+    }
 }
 /**
 * @brief This method handles local events
 * 
-* Method need to use cv - to sleep and to wake up when teminate flag set.
+* Called by the timer wheel when the timeout of the event expires.
 *
-*@param eventPointer Incoming local event to component
+*@param event Incoming local event to component
 */
-void Component::local_message_arrived(std::shared_ptr<Event> eventPointer)
+void Component::local_message_arrived(Event &event)
 {
-    {
-        std::unique_lock<std::mutex> lock(fut_mtx);
-        if (comp_cv.wait_for(lock, std::chrono::milliseconds(eventPointer->getTimeout()), [] {return terminateFlag.load();})){
-            std::cout<<"["<<c_name <<" (" << pid << ")] Terminate local event "<< eventPointer->getE_name()<<std::endl;
-                return;
-        }
-    }
     Comp_log::Comp_logCreator(
-            eventPointer->getE_name(),
+            event.log_id,
                 getPid(), 
                 ph_type::I, 
-                {"event", "local", "event_rcv"}
+                Comp_log::cat_local_event_rcv
     );
-    receiveEvent(eventPointer->getE_name());
+    postEvent(eids_events[event.id]);
+}
+/**
+ * @brief Handles an incoming MQTT message (from the broker or from the in-process bus in simulation mode).
+ *
+ * If the component has an event with the topic, the event is logged and queued.
+ *
+ * @param topic Topic of the message.
+ */
+void Component::messageArrived(const std::string &topic)
+{
+    std::shared_ptr<Event> eventPointer;
+    unsigned short cat = Comp_log::cat_app_event_rcv;
+    if(eventPointer = mgetEvent(topic)){ //Takes event ptr by mqtt_topic
+        if (eventPointer->getType() == E_type::e)
+            cat = Comp_log::cat_env_event_rcv;
+        Comp_log::Comp_logCreator(
+            eventPointer->log_id, 
+            pid, 
+            ph_type::I, 
+            cat
+        );
+        //Proccess event (queued, so the callback thread doesn't wait for the transition)
+        postEvent(eventPointer);
+    }
+}
+/**
+ * @brief Queues an incoming event of the component.
+ *
+ * Events are processed by `receiveEvent` in order, one at a time per component, on a thread of the executor,
+ * so the MQTT callback thread and the timer thread don't wait for transitions.
+ *
+ * @param eventPointer Incoming event.
+ */
+void Component::postEvent(std::shared_ptr<Event> eventPointer)
+{
+    if (mailbox.push(std::move(eventPointer)))
+        Executor::submit([this]() { drainMailbox(); });
+}
+/**
+ * @brief Processes queued events (only one task of the component at a time).
+ *
+ * After a batch of events the task is submitted again, so a busy component doesn't hold the thread.
+ * Events which arrive after termination are dropped.
+ */
+void Component::drainMailbox()
+{
+    const unsigned int batch_size = 64;
+    for (unsigned int processed = 0; processed < batch_size; ++processed)
+    {
+        long long enqueued;
+        std::shared_ptr<Event> eventPointer;
+        while (!(eventPointer = mailbox.pop(enqueued)))
+            std::this_thread::yield(); // the event is counted, but not linked by the producer yet
+        if (!terminateFlag.load())
+            receiveEvent(*eventPointer);
+        if (!mailbox.processedOne(enqueued))
+            return;
+    }
+    Executor::submit([this]() { drainMailbox(); });
+}
+/**
+ * @brief Prints counters of the mailbox (used at the end of emulation).
+ */
+void Component::printMailboxStats()
+{
+    unsigned long long processed = mailbox.processed.load();
+    if (processed == 0)
+        return;
+    std::cout << "[" << c_name << " (" << pid << ")] Events: " << processed << " processed, max queue depth " << mailbox.max_depth.load()
+              << ", latency avg " << mailbox.total_latency.load() / processed / 1000 << " us, max " << mailbox.max_latency.load() / 1000 << " us" << std::endl;
+}
+/**
+ * @brief Prints how late packets of a client port were sent behind their deadlines.
+ */
+void Component::printFlowStats(const Client_flow &flow, const Flow_stats &stats)
+{
+    if (stats.late_count == 0)
+        return;
+    std::cout << "[" << c_name << " (" << pid << ")] Client " << flow.port->getP_name();
+    if (flow.shards > 1)
+        std::cout << " (" << flow.shards << " shards)";
+    std::cout << ": " << stats.late_count << " deadlines, lateness avg "
+              << stats.late_total / static_cast<long long>(stats.late_count) / 1000 << " us, max " << stats.late_max / 1000 << " us, "
+              << stats.skipped << " packets skipped" << std::endl;
 }
 /**
  * @brief Logs a state change for a Finite State Machine (FSM).
  *
- * This method creates a log entry indicating a change in the FSM's state.
+ * This method begins the log of the current state (the log of the previous state is ended by transitFsm).
+ * A begin dropped by the log filter only drops the log of this state.
  * 
  * @param fsm The FSM whose state change is being logged.
  */
-void Component::logStateChange(std::shared_ptr<Fsm> fsm) {
-    Comp_log::Comp_logCreator(
-        fsm->getM_name(), 
+void Component::logStateChange(Fsm &fsm) {
+    fsm.state_span = Comp_log::beginSpan(
+        fsm.log_id, 
         this->pid, 
-        ph_type::BE, 
-        {"state"}, 
-        {fsm->getS_name()}
+        Comp_log::cat_state, 
+        {Comp_log::textArg(fsm.getState(fsm.getS_id()).log_id)}
     );
 }
 /**
  * @brief Handles an incoming event.
  *
- * This method checks each Finite State Machine (FSM) to determine if the occurrence of an event affects a state change (transition). 
- * If not, it proceeds to the next FSM.
+ * Only FSMs with a transition on the event are checked (`eids_fsmgroups`). Groups of FSMs which share
+ * no actions are dispatched concurrently on the executor, FSMs of a group one after another in a fixed order.
+ * The method returns when every group is done, so the next event of the component sees the new states.
+ * In simulation mode groups run one after another.
  * 
+ * @param event The event.
+ */
+void Component::receiveEvent(Event &event)
+{
+    auto &groups = eids_fsmgroups[event.id];
+    if (groups.empty())
+        return;
+    struct Pending
+    {
+        std::mutex mtx;
+        std::condition_variable cv;
+        size_t count;
+    };
+    std::shared_ptr<Pending> pending;
+    if (groups.size() > 1 && !Simulator::enabled) {
+        pending = std::make_shared<Pending>();
+        pending->count = groups.size() - 1;
+        for (size_t i = 1; i < groups.size(); ++i)
+            Executor::submit([this, &groups, i, &event, pending]() {
+                for (Fsm *fsm : groups[i])
+                    transitFsm(*fsm, event);
+                std::lock_guard<std::mutex> lock(pending->mtx);
+                if (--pending->count == 0)
+                    pending->cv.notify_one();
+            });
+    }
+    // The first group runs on the calling task (every group in simulation mode, there is one thread)
+    for (size_t i = 0; i < (pending ? 1 : groups.size()); ++i)
+        for (Fsm *fsm : groups[i])
+            transitFsm(*fsm, event);
+    if (pending) {
+        std::unique_lock<std::mutex> lock(pending->mtx);
+        pending->cv.wait(lock, [&pending] { return pending->count == 0; });
+    }
+}
+/**
+ * @brief Makes the transition of an FSM on the event, if the current state has one.
+ *
  * Additional info:
  * 
- * `mnames_fsms` is an unordered map that correlates FSM names with pointers to FSM objects.
+ * `getTransition` indexes the compiled table of the FSM by the current state id and the event id.
  * 
- * `getTransition` returns a pointer to the transition associated with the event name.
+ * `getCompiled_state` returns the resolved on-entry and on-exit actions of a state.
  * 
- * `getState` returns a pointer to the state associated with the state name.
- * 
- * @param e_name The name of the event.
+ * @param fsm The FSM.
+ * @param event The event.
  */
-void Component::receiveEvent(const std::string e_name)
+void Component::transitFsm(Fsm &fsm, Event &event)
 {
-    std::shared_ptr<Transition> transitionPointer;
-    for (auto &fsmEntry : this->mnames_fsms)
-    {
-        std::shared_ptr<Fsm> fsm = fsmEntry.second;
-        std::shared_ptr<State> state = fsm->getState(fsm->getS_name());
-
-        // Check if a transition exists for the current state or continue to the next FSM
-        if (!(transitionPointer = state->getTransition(e_name)))
-            continue;
+    unsigned int s_id = fsm.getS_id();
+    const Fsm::Compiled_transition &transition = fsm.getTransition(s_id, event.id);
 
-        // Exit actions from the state
-        auto on_exit_actions = std::async(std::launch::async, [this, state]() {
-            for (auto &action : state->getOn_exit())
-                handleEventActions(action);
-        });
-        
-        // Log the state change before exiting the state(to end)
-        logStateChange(fsm);
+    // Check if a transition exists for the current state
+    if (transition.target == Fsm::no_transition)
+        return;
 
-        // Wait for exit actions to complete before performing the transition
-        on_exit_actions.get();
+    // Actions only publish messages or submit local events, so they run on the calling thread
+    // (every group of actions has to complete before the next step anyway).
 
-        // Actions for transitioning between states
-        auto transit_actions = std::async(std::launch::async, [this, transitionPointer]() {
-            for (auto &action : transitionPointer->getActions())
-                handleEventActions(action);
-        });
+    // Exit actions from the state
+    for (Event *action : fsm.getCompiled_state(s_id).on_exit)
+        handleEventActions(*action);
+    
+    // End the log of the state before exiting it
+    Comp_log::endSpan(fsm.state_span);
 
-        // Set the new state
-        fsm->setS_name(transitionPointer->getS_name());
+    // Actions for transitioning between states
+    for (Event *action : transition.actions)
+        handleEventActions(*action);
 
-        // Notify about the state change (ports with correlated FSMs will see the change)
-        fsm->cv.notify_all();
-        
-        // Log the new state
-        logStateChange(fsm);
+    // Set the new state
+    fsm.setS_id(transition.target);
 
-        // Wait for transition actions to complete before continuing
-        transit_actions.get();
+    // Notify about the state change (ports with correlated FSMs will see the change)
+    Flow_scheduler::fsmChanged(&fsm);
+    
+    // Log the new state
+    logStateChange(fsm);
 
-        // Start on-entry actions (and ensure they complete before a potential new state change)
-        std::async(std::launch::async, [this, fsm]() {
-            for (auto &action : fsm->getState(fsm->getS_name())->getOn_entry())
-                handleEventActions(action);
-        }).get();
-    }
+    // On-entry actions (complete before a potential new state change)
+    for (Event *action : fsm.getCompiled_state(transition.target).on_entry)
+        handleEventActions(*action);
 }
 
 /**
@@ -210,9 +397,25 @@ void Component::receiveEvent(const std::string e_name)
  * Additional info:
  * 
  * `enames_events` is an unordered map that correlates event names with pointers to event objects.
+ * 
+ * In simulation mode topics are subscribed on the in-process bus of the simulator.
  */
 void Component::subscribeEvents()
 {
+    if (Simulator::enabled) {
+        for (const auto& event_pair : this->enames_events)
+        {
+            std::shared_ptr<Event> event = event_pair.second;
+            if (event->getType() == E_type::e || event->getType() == E_type::i || event->getType() == E_type::io)
+            {
+                std::string topic = event->getMqtt_e_name();
+                mqtttopic_events[topic] = event;
+                std::cout << "[" << c_name << " (" << pid << ")] Subscribing to topic '" << topic << "'\n";
+                Simulator::subscribe(topic, [this, topic]() { messageArrived(topic); });
+            }
+        }
+        return;
+    }
     // Create a callback with c_name (for better search performance for incoming MQTT messages)
     auto cb = std::make_shared<ReceiveCallback>(c_name);
 
@@ -292,7 +495,13 @@ void Component::subscribeEvents()
  */
 void Component::cleanupSocket(int &sockfd,const std::string& p_name)
 {
+    {
+        std::lock_guard<std::mutex> lock(sockets_mtx);
+        blocking_sockets.erase(sockfd);
+    }
     std::cout<<"["<<c_name <<" (" << pid << ")] Closing port "<<p_name<< std::endl;
+    if (Simulator::enabled) // ports of the in-memory transport have no socket
+        return;
     #ifdef _WIN32
         if (closesocket(sockfd) == SOCKET_ERROR)
             std::cerr<<"["<<c_name <<" (" << pid << ")] error closing socket "<<p_name<< std::endl;
@@ -301,6 +510,73 @@ void Component::cleanupSocket(int &sockfd,const std::string& p_name)
             std::cerr<<"["<<c_name <<" (" << pid << ")] error closing socket "<<p_name<< std::endl;
     #endif
 }
+/**
+ * @brief Creates the descriptor which wakes up waits of ports at termination.
+ *
+ * On Linux it is an eventfd, elsewhere a UDP socket on loopback (self-pipe, select on Windows accepts only sockets).
+ * It is never read, so it stays readable after `terminate`.
+ *
+ * @return false if the descriptor can't be created.
+ */
+bool Component::initWakeup()
+{
+#ifdef __linux__
+    wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    return wake_fd >= 0;
+#else
+    wake_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in wake_addr = {};
+    wake_addr.sin_family = AF_INET;
+    wake_addr.sin_port = 0;
+    inet_pton(AF_INET, "127.0.0.1", &wake_addr.sin_addr);
+    return wake_fd >= 0 && bind(wake_fd, reinterpret_cast<sockaddr*>(&wake_addr), sizeof(wake_addr)) == 0;
+#endif
+}
+/**
+ * @brief Ends the emulation: sets terminateFlag and wakes up every thread which waits.
+ *
+ * Threads waiting on comp_cv are notified, waits of ports see the readable wake up descriptor
+ * and sockets blocked in connect, send or recv are shut down.
+ */
+void Component::terminate()
+{
+    {
+        std::lock_guard<std::mutex> lock(comp_mtx);
+        terminateFlag.store(true);
+    }
+    comp_cv.notify_all();
+#ifdef __linux__
+    uint64_t one = 1;
+    if (write(wake_fd, &one, sizeof(one)) < 0)
+        std::cerr << "Wake up error" << std::endl;
+#else
+    sockaddr_in wake_addr = {};
+    socklen_t wake_len = sizeof(wake_addr);
+    getsockname(wake_fd, reinterpret_cast<sockaddr*>(&wake_addr), &wake_len);
+    sendto(wake_fd, "q", 1, 0, reinterpret_cast<sockaddr*>(&wake_addr), wake_len);
+#endif
+    std::lock_guard<std::mutex> lock(sockets_mtx);
+    for (int sockfd : blocking_sockets)
+    #ifdef _WIN32
+        shutdown(sockfd, SD_BOTH);
+    #else
+        shutdown(sockfd, SHUT_RDWR);
+    #endif
+}
+/**
+ * @brief Registers a socket which can block a thread (shut down at termination, forgotten by cleanupSocket).
+ */
+void Component::trackSocket(int sockfd)
+{
+    std::lock_guard<std::mutex> lock(sockets_mtx);
+    if (terminateFlag.load())
+    #ifdef _WIN32
+        shutdown(sockfd, SD_BOTH);
+    #else
+        shutdown(sockfd, SHUT_RDWR);
+    #endif
+    blocking_sockets.insert(sockfd);
+}
 /**
  * @brief Sets up a server socket.
  *
@@ -311,76 +587,71 @@ void Component::cleanupSocket(int &sockfd,const std::string& p_name)
  * The server socket can handle multiple TCP sessions and multiple TCP/UDP messages simultaneously.
  * It can also handle new sessions during active TCP connections.
  * 
+ * On Linux the socket and accepted TCP connections are given to reactors (epoll or io_uring), so no thread waits on them,
+ * with `Reactor::reuseport` every reactor gets its own socket of the port (SO_REUSEPORT).
+ * On Windows the port is handled by this task with select.
+ * In simulation mode the port listens on the in-memory transport of the simulator.
+ * 
  * @param port The port pointer with necessary information about the socket.
  * @param listenFlag Indicates whether the socket should be set up for TCP (true) or UDP (false).
  */
 void Component::setupServerSocket(const std::shared_ptr<Port> &port, bool listenFlag)
 {
-    int server_socket;
-    if (listenFlag)
-        server_socket = socket(AF_INET, SOCK_STREAM, 0); // Create a TCP socket if listening
-    else
-        server_socket = socket(AF_INET, SOCK_DGRAM, 0); // Create a UDP socket if not listening
-    
     auto p_name = port->getP_name();
-    if (server_socket < 0)
-    {
-        std::cerr << "[" << c_name << " (" << pid << ")] Server " << p_name << " error creating server socket" << std::endl;
+    if (Simulator::enabled) {
+        unsigned int p_log_id = port->log_id;
+        Simulator::listen(listenFlag, port->getLocal_IP(), port->getLocal_port(), [this, listenFlag, p_log_id](const char *data, int size) {
+            packetArrived(!listenFlag, p_log_id, data, size);
+        });
         return;
     }
-
-    sockaddr_in server_addr = {};
-    server_addr.sin_family = AF_INET;
-    auto local_port = port->getLocal_port();
-    // Convert port number to network byte order
-    server_addr.sin_port = htons(local_port); 
-    sockaddr_in client_addr = {};
-    socklen_t client_len = sizeof(client_addr);
-
-    fd_set readfds;
-    
-    // For multiple TCP connections, handle clients in separate threads
-    std::mutex client_mtx;
-    std::vector<std::future<void>> client_futures;
-   
-    auto local_IP = port->getLocal_IP();
-
-    // Convert IP address to network byte order
-    if (inet_pton(AF_INET, local_IP.c_str(), &server_addr.sin_addr) <= 0) 
+#ifdef __linux__
+    size_t shards = Reactor::reuseport ? Reactor::count() : 1;
+    for (size_t shard = 0; shard < shards; ++shard)
     {
-        std::cerr << "[" << c_name << " (" << pid << ")] Server " << p_name << " invalid address or address not supported" << std::endl;
-        cleanupSocket(server_socket, p_name);
-        return;
-    }
+        int server_socket = openServerSocket(port, listenFlag);
+        if (server_socket < 0)
+            return;
+        auto on_close = [this, server_socket, p_name]() mutable { cleanupSocket(server_socket, p_name); };
+        if (listenFlag)
+            Reactor::accept(server_socket, [this, p_name, port](int client_socket) { // Accept new TCP connection
+                if (client_socket < 0)
+                {
+                    std::cerr << "[" << c_name << " (" << pid << ")] Server " << p_name << " accept failed" << std::endl;
+                    return;
+                }
+                std::cout << "[" << c_name << " (" << pid << ")] Server " << p_name << " accepted connection" << std::endl;
 
-    if (bind(server_socket, reinterpret_cast<sockaddr*>(&server_addr), sizeof(server_addr)) < 0)
-    {
-        std::cerr << "[" << c_name << " (" << pid << ")] Server " << p_name << " bind failed" << std::endl;
-        cleanupSocket(server_socket, p_name);
-        return;
+                // The connection is handled by the next reactor until the client disconnects (persistent mode)
+                Reactor::receive(client_socket, [this, client_socket, p_name, port](const char *data, int size) {
+                    return !dataReceived(false, client_socket, p_name, port->log_id, data, size);
+                }, [this, client_socket]() mutable { cleanupSocket(client_socket, "client port"); });
+            }, on_close, shard);
+        else
+            Reactor::receive(server_socket, [this, server_socket, p_name, port](const char *data, int size) {
+                dataReceived(true, server_socket, p_name, port->log_id, data, size);
+                return true;
+            }, on_close, shard);
     }
-    if (listenFlag && listen(server_socket, SOMAXCONN) < 0)
-    {
-        std::cerr << "[" << c_name << " (" << pid << ")] Server " << p_name << " listen failed" << std::endl;
-        cleanupSocket(server_socket, p_name);
+#else
+    int server_socket = openServerSocket(port, listenFlag);
+    if (server_socket < 0)
         return;
-    }
 
+    sockaddr_in client_addr = {};
+    socklen_t client_len = sizeof(client_addr);
+    fd_set readfds;
     int client_socket;
 
-    // Use select to block for a limited time (can check terminateFlag)
+    // Use select until the wake up descriptor becomes readable (terminateFlag is set)
     while (!terminateFlag.load())
     {
         FD_ZERO(&readfds);
         FD_SET(server_socket, &readfds);
-        
-        // Block for 5 seconds
-        struct timeval timeout;
-        timeout.tv_sec = 5;
-        timeout.tv_usec = 0;
+        FD_SET(wake_fd, &readfds);
 
         // Check if there is activity on the socket (potential new tcp connection or UDP datagram)
-        int activity = select(server_socket + 1, &readfds, nullptr, nullptr, &timeout);
+        int activity = select(std::max(server_socket, wake_fd) + 1, &readfds, nullptr, nullptr, nullptr);
 
         if (activity < 0)
         {
@@ -401,33 +672,86 @@ void Component::setupServerSocket(const std::shared_ptr<Port> &port, bool listen
                 }
                 else
                     std::cout << "[" << c_name << " (" << pid << ")] Server " << p_name << " accepted connection" << std::endl;
+                trackSocket(client_socket);
 
-                // Create a new thread for the new TCP client (can end when client disconnects)
-                {
-                    std::lock_guard<std::mutex> lock(client_mtx);
-                    client_futures.push_back(std::async(std::launch::async, [this, client_socket, p_name]() {
-                        while (!terminateFlag.load()) { // Maintain connection while client is in persistent mode
-                            if (handleClient(false, client_socket, p_name))
-                                break;
-                        }
-                    }));
-                }
+                // Handle the new TCP client on a thread of the executor (can end when client disconnects)
+                Executor::submit([this, client_socket, p_name, port]() {
+                    while (!terminateFlag.load()) { // Maintain connection while client is in persistent mode
+                        if (handleClient(false, client_socket, p_name, port->log_id))
+                            break;
+                    }
+                });
 
             }
             else
-                handleClient(true, server_socket, p_name, &client_addr, &client_len); // Handle UDP client without threading
+                handleClient(true, server_socket, p_name, port->log_id, &client_addr, &client_len); // Handle UDP client without threading
         }
     }
-    // Clean up client threads after termination
+    // Close the server socket (receives of TCP clients are ended by terminate, the executor waits for their handlers)
+    cleanupSocket(server_socket, p_name);               
+#endif
+}
+/**
+ * @brief Opens, binds and (for TCP) listens a server socket of the port.
+ *
+ * On Linux the socket is non-blocking (it is owned by a reactor) and can share the port with sockets
+ * of other reactors (SO_REUSEPORT).
+ *
+ * @param port The port pointer with necessary information about the socket.
+ * @param listenFlag Indicates whether the socket should be set up for TCP (true) or UDP (false).
+ * @return The socket, or -1 on error (the error is printed).
+ */
+int Component::openServerSocket(const std::shared_ptr<Port> &port, bool listenFlag)
+{
+    int server_socket;
     if (listenFlag)
+        server_socket = socket(AF_INET, SOCK_STREAM, 0); // Create a TCP socket if listening
+    else
+        server_socket = socket(AF_INET, SOCK_DGRAM, 0); // Create a UDP socket if not listening
+    
+    auto p_name = port->getP_name();
+    if (server_socket < 0)
+    {
+        std::cerr << "[" << c_name << " (" << pid << ")] Server " << p_name << " error creating server socket" << std::endl;
+        return -1;
+    }
+
+    sockaddr_in server_addr = {};
+    server_addr.sin_family = AF_INET;
+    auto local_port = port->getLocal_port();
+    // Convert port number to network byte order
+    server_addr.sin_port = htons(local_port); 
+   
+    auto local_IP = port->getLocal_IP();
+
+    // Convert IP address to network byte order
+    if (inet_pton(AF_INET, local_IP.c_str(), &server_addr.sin_addr) <= 0) 
     {
-        std::lock_guard<std::mutex> lock(client_mtx);
-        for (auto &client : client_futures)
-            if (client.valid())
-                client.get();
+        std::cerr << "[" << c_name << " (" << pid << ")] Server " << p_name << " invalid address or address not supported" << std::endl;
+        cleanupSocket(server_socket, p_name);
+        return -1;
     }
-    // Close the server socket
-    cleanupSocket(server_socket, p_name);               
+
+#ifdef __linux__
+    fcntl(server_socket, F_SETFL, fcntl(server_socket, F_GETFL, 0) | O_NONBLOCK);
+    int enable = 1;
+    if (Reactor::reuseport && setsockopt(server_socket, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) < 0)
+        std::cerr << "[" << c_name << " (" << pid << ")] Server " << p_name << " SO_REUSEPORT failed" << std::endl;
+#endif
+
+    if (bind(server_socket, reinterpret_cast<sockaddr*>(&server_addr), sizeof(server_addr)) < 0)
+    {
+        std::cerr << "[" << c_name << " (" << pid << ")] Server " << p_name << " bind failed" << std::endl;
+        cleanupSocket(server_socket, p_name);
+        return -1;
+    }
+    if (listenFlag && listen(server_socket, SOMAXCONN) < 0)
+    {
+        std::cerr << "[" << c_name << " (" << pid << ")] Server " << p_name << " listen failed" << std::endl;
+        cleanupSocket(server_socket, p_name);
+        return -1;
+    }
+    return server_socket;
 }
 /**
  * @brief Handles communication with a UDP/TCP client.
@@ -437,14 +761,15 @@ void Component::setupServerSocket(const std::shared_ptr<Port> &port, bool listen
  * @param isUDP Indicates whether the connection is UDP (true) or TCP (false).
  * @param socket The server socket.
  * @param p_name The port name for logging purposes.
+ * @param p_log_id The interned port name for logs.
  * @param client_addr Optional client address (used for logging but not currently used).
  * @param client_len Optional client length(Determiantes IPv4 or IPv6) (used for logging but not currently used).
  * @return Returns true if the server should disconnect from the client.
  */
-bool Component::handleClient(bool isUDP, int socket, const std::string &p_name, sockaddr_in* client_addr, socklen_t* client_len) {
+bool Component::handleClient(bool isUDP, int socket, const std::string &p_name, const unsigned int &p_log_id, sockaddr_in* client_addr, socklen_t* client_len) {
     
-    // Specify a buffer size for receiving data
-    std::vector<char> buffer(1024);
+    // Specify a buffer size for receiving data (reused by every call on the thread)
+    static thread_local std::vector<char> buffer(1024);
     int bytes_received;
 
     // Receive data depending on whether the connection is UDP or TCP
@@ -454,30 +779,52 @@ bool Component::handleClient(bool isUDP, int socket, const std::string &p_name,
         bytes_received = recv(socket, buffer.data(), buffer.size(), 0);
 
 
-    if (bytes_received < 0)
+    #ifndef _WIN32
+        if (bytes_received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) // Nothing to read on a non-blocking socket
+            return false;
+    #endif
+    return dataReceived(isUDP, socket, p_name, p_log_id, buffer.data(), bytes_received);
+}
+/**
+ * @brief Handles data received from a UDP/TCP client (by handleClient or a reactor).
+ *
+ * @param isUDP Indicates whether the connection is UDP (true) or TCP (false).
+ * @param socket The server socket (closed if the TCP client disconnected).
+ * @param p_name The port name for logging purposes.
+ * @param p_log_id The interned port name for logs.
+ * @param data Received data.
+ * @param bytes_received Size of the data, 0 if the TCP client disconnected, < 0 on error.
+ * @return Returns true if the server should disconnect from the client.
+ */
+bool Component::dataReceived(bool isUDP, int socket, const std::string &p_name, const unsigned int &p_log_id, const char *data, int bytes_received) {
+    if (bytes_received < 0) {
         std::cerr << "[" << c_name << " (" << pid << ")] Server " << p_name << " error receiving data" << std::endl; // Can also indicate client stop or failure
+    }
     else if (bytes_received == 0 && !isUDP) {
         std::cout << "[" << c_name << " (" << pid << ")] Server " << p_name << " client disconnected" << std::endl; 
         cleanupSocket(socket, "client port");
         return true;  
-    } else {
-        // Log the received data
-        std::string packet_data(buffer.data(), bytes_received);
-        Comp_log::Comp_logCreator(
-            p_name,
-            pid,
-            ph_type::I,
-            {"port", "packet", "packet_rcv"},
-            {isUDP ? "UDP" : "TCP", packet_data}
-        );
-    }
+    } else
+        packetArrived(isUDP, p_log_id, data, bytes_received);
     return false;
 }
+/**
+ * @brief Logs a received packet (value written by the client at the start of the packet).
+ */
+void Component::packetArrived(bool isUDP, const unsigned int &p_log_id, const char *data, int size) {
+    Comp_log::Comp_logCreator(
+        p_log_id,
+        pid,
+        ph_type::I,
+        Comp_log::cat_packet_rcv,
+        {Comp_log::textArg(isUDP ? log_UDP : log_TCP), Comp_log::numberArg(Helper_functions::leadingNumber(data, size))}
+    );
+}
 
 /**
  * @brief Sets up a client socket.
  *
- * This method opens a client socket (TCP or UDP).
+ * This method opens a client socket (TCP or UDP) and gives it to the flow scheduler.
  * 
  * Additional info:
  * 
@@ -489,159 +836,664 @@ bool Component::handleClient(bool isUDP, int socket, const std::string &p_name,
  * 
  * Flow types are used only for predefined buffer sizes and times between transport packets.
  * 
- * The message value is a random number uniformly distributed within the buffer size, expressed in bytes.
+ * A port with parallelism N opens N sockets (shards, with their own source ports and TCP connections),
+ * which are given to different pacing threads. Every shard sends every N-th packet of the flow.
+ * Shards are given to the flow scheduler only when all of them are connected, otherwise the port is closed.
  * 
  * @param port The port pointer with necessary information about the socket.
  * @param listenFlag Indicates whether the socket should be set up for TCP (true) or UDP (false).
  */
 void Component::setupClientSocket(std::shared_ptr<Port> port, bool listenFlag) {
-    int client_socket;
-    if (listenFlag)
-        client_socket = socket(AF_INET, SOCK_STREAM, 0);
-    else
-        client_socket = socket(AF_INET, SOCK_DGRAM, 0);
     auto p_name = port->getP_name();
-
-    if (client_socket == -1) {
-        std::cerr<<"["<<c_name <<" (" << pid << ")] Client "<<p_name<<" error reating client socket" << std::endl;
-        return;
-    }
-
     sockaddr_in server_addr;
     server_addr.sin_family = AF_INET;
 
     //Client info have information about neccessary informations 
     auto client_info = port->getClient_info();
+    auto fsm = getFsm(client_info->getM_name());
+    if (!fsm) {
+        std::cerr<<"["<<c_name <<" (" << pid << ")] Client "<<p_name<<" FSM " << client_info->getM_name() << " not found" << std::endl;
+        return;
+    }
     // Convert port to network format
     server_addr.sin_port = htons(client_info->getRemote_port());
 
     //Convert IP address to network format
     if (inet_pton(AF_INET, client_info->getRemote_IP().c_str(), &server_addr.sin_addr) <= 0) {
         std::cerr<<"["<<c_name <<" (" << pid << ")] Client "<<p_name<<" invalid address or address not supported" << std::endl;
-        cleanupSocket(client_socket,p_name);
         return;
     }
-    // Loop for connecting to server(1 second delay between connection).
-    if (listenFlag) {
-        while (connect(client_socket, reinterpret_cast<struct sockaddr *>(&server_addr), sizeof(server_addr)) < 0 && !terminateFlag.load()) {
-            std::cerr<<"["<<c_name <<" (" << pid << ")] Client "<<p_name<<" failed to connect to server (try again in 1 second)" << std::endl;
-            std::this_thread::sleep_for(std::chrono::seconds(1));
+
+    // Every shard is connected before any of them sends, the port sends its whole schedule or nothing
+    const unsigned int shards = client_info->getParallelism();
+    std::vector<std::unique_ptr<Client_flow>> shard_flows;
+    auto cleanupShards = [this, &shard_flows, &p_name]() {
+        for (auto &opened : shard_flows)
+            if (!Simulator::enabled)
+                cleanupSocket(opened->socket, p_name);
+    };
+    for (unsigned int shard = 0; shard < shards; ++shard) {
+        int client_socket;
+        if (Simulator::enabled)
+            client_socket = -1; // packets are sent by the in-memory transport
+        else if (listenFlag)
+            client_socket = socket(AF_INET, SOCK_STREAM, 0);
+        else
+            client_socket = socket(AF_INET, SOCK_DGRAM, 0);
+
+        if (client_socket == -1 && !Simulator::enabled) {
+            std::cerr<<"["<<c_name <<" (" << pid << ")] Client "<<p_name<<" error reating client socket" << std::endl;
+            cleanupShards();
+            return;
+        }
+        // Loop for connecting to server(1 second delay between connection).
+        if (listenFlag && !Simulator::enabled) {
+            trackSocket(client_socket);
+            if (!connectClient(client_socket, server_addr, p_name)) {
+                cleanupSocket(client_socket, p_name);
+                cleanupShards();
+                return;
+            }
+            std::cout<<"["<<c_name <<" (" << pid << ")] Client "<<p_name<<" connect to Server" << std::endl;
+        }
+
+        // Packets are sent by the flow scheduler (the socket is closed by it)
+        std::unique_ptr<Client_flow> flow(new Client_flow());
+        flow->component = this;
+        flow->port = port;
+        flow->fsm = fsm; // Fsm which control flow
+        flow->client_info = client_info.get();
+        flow->socket = client_socket;
+        flow->listenFlag = listenFlag;
+        flow->server_addr = server_addr;
+        flow->gso = true;
+#ifdef __linux__
+        if (listenFlag && Flow_scheduler::zerocopy_min && !Simulator::enabled) {
+            int one = 1;
+            flow->zerocopy = setsockopt(client_socket, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0; // kernel 4.14+
         }
-        std::cout<<"["<<c_name <<" (" << pid << ")] Client "<<p_name<<" connect to Server" << std::endl;
-    }
-    //Interval - time between transport packets
-    std::chrono::milliseconds interval,on_interval,off_interval;
-    // Variables for generating random value
-    std::minstd_rand generator(std::random_device{}()); 
-    std::uniform_int_distribution<unsigned int> distribution;
-    std::shared_ptr<Flow> actualFlow;     //Actual Flow pointer use in program
-    std::vector<std::string> args;     // Args use in logs
-    std::vector<char> buffer;  
-    bool on_state; //Actual state(for SIMPLE Flow always true)
-    unsigned int randomvalue;
-    std::chrono::steady_clock::time_point start, now; // Use to compute on/off time
-    auto fsm = getFsm(client_info->getM_name()); // Fsm which control flow
-    std::unique_lock<std::mutex> lock(fsm->cv_mtx); // Lock mutex(need for cv) 
-    while (!terminateFlag) {
-        auto flow = client_info->getFlow(fsm->getS_name());  //Take actual flow
-        if (!flow){ //Check new flow(if nullptr error)
-            std::cerr<<"["<<c_name <<" (" << pid << ")] Client "<<p_name<<" have invalid flow.\n";
+#endif
+        flow->shard = shard;
+        flow->shards = shards;
+        flow->generator.seed(Simulator::enabled ? port->log_id + shard : std::random_device{}()); // simulation runs are repeatable
+        shard_flows.push_back(std::move(flow));
+    }
+    for (auto &flow : shard_flows)
+        Flow_scheduler::add(std::move(flow));
+}
+
+/**
+ * @brief Connects a TCP client socket, tries again every second until the server accepts the connection.
+ *
+ * The connection is made in non-blocking mode and waits together with the wake up descriptor,
+ * so termination ends the attempt immediately. The socket is blocking again when the function returns.
+ *
+ * @param client_socket The TCP socket.
+ * @param server_addr Address of the server.
+ * @param p_name Name of the port (for messages).
+ * @return false if the emulation was terminated before the connection was made.
+ */
+bool Component::connectClient(int client_socket, const sockaddr_in &server_addr, const std::string &p_name) {
+#ifdef _WIN32
+    u_long mode = 1;
+    ioctlsocket(client_socket, FIONBIO, &mode);
+#else
+    int flags = fcntl(client_socket, F_GETFL, 0);
+    fcntl(client_socket, F_SETFL, flags | O_NONBLOCK);
+#endif
+    bool connected = false;
+    while (!terminateFlag.load()) {
+        int result = connect(client_socket, reinterpret_cast<const sockaddr *>(&server_addr), sizeof(server_addr));
+    #ifdef _WIN32
+        bool inProgress = result < 0 && WSAGetLastError() == WSAEWOULDBLOCK;
+    #else
+        bool inProgress = result < 0 && errno == EINPROGRESS;
+    #endif
+        if (inProgress) {
+            // Wait until the connection is made or refused, or the emulation ends
+        #ifdef _WIN32
+            fd_set writefds, exceptfds, readfds;
+            FD_ZERO(&writefds);
+            FD_ZERO(&exceptfds);
+            FD_ZERO(&readfds);
+            FD_SET(client_socket, &writefds);
+            FD_SET(client_socket, &exceptfds);
+            FD_SET(wake_fd, &readfds);
+            select(0, &readfds, &writefds, &exceptfds, nullptr);
+        #else
+            pollfd fds[2] = {{client_socket, POLLOUT, 0}, {wake_fd, POLLIN, 0}};
+            while (poll(fds, 2, -1) < 0 && errno == EINTR) {}
+        #endif
+            if (terminateFlag.load())
+                break;
+            int error = 0;
+            socklen_t len = sizeof(error);
+            getsockopt(client_socket, SOL_SOCKET, SO_ERROR, reinterpret_cast<char *>(&error), &len);
+            result = error == 0 ? 0 : -1;
+        }
+        if (result == 0) {
+            connected = true;
             break;
         }
-        if (flow != actualFlow) { 
-            if (actualFlow) { // Log for previous flow(to end)
-                Comp_log::Comp_logCreator(
-                    actualFlow->getF_name(), 
-                    this->pid, 
-                    ph_type::BE, 
-                    {"port", "flow"}, 
-                    args
-                );
+        std::cerr<<"["<<c_name <<" (" << pid << ")] Client "<<p_name<<" failed to connect to server (try again in 1 second)" << std::endl;
+        std::unique_lock<std::mutex> lock(comp_mtx);
+        comp_cv.wait_for(lock, std::chrono::seconds(1), [] {return terminateFlag.load();});
+    }
+#ifdef _WIN32
+    mode = 0;
+    ioctlsocket(client_socket, FIONBIO, &mode);
+#else
+    fcntl(client_socket, F_SETFL, flags);
+#endif
+    return connected;
+}
+
+/**
+ * @brief Prepares the next packet of a client port.
+ *
+ * Called by the flow scheduler at start, after every sent packet and when the FSM changes state.
+ * The flow of the actual state is checked only when the epoch of the FSM changed (no locks or lookups per packet).
+ * If the flow of the actual state is different, the log of the previous flow ends and the log of the new one begins.
+ * 
+ * @param flow The client port.
+ * @return false if the actual state has no valid flow (the port has to be closed).
+ */
+bool Component::prepareFlow(Client_flow &flow) {
+    Fsm *fsm = flow.fsm.get();
+    auto &actualFlow = flow.actualFlow;
+    unsigned long long epoch = fsm->getEpoch();
+    bool restarted = false; // the schedule of the flow starts again
+    if (!actualFlow || epoch != flow.epoch) { // The state was changed since the last check
+        restarted = true;
+        unsigned int s_id = fsm->getS_id();
+        Flow *newFlow = flow.client_info->getFlow(s_id);  //Take actual flow
+        if (!newFlow){ //Check new flow(if nullptr error)
+            std::cerr<<"["<<c_name <<" (" << pid << ")] Client "<<flow.port->getP_name()<<" have invalid flow.\n";
+            return false;
+        }
+        flow.state_log_id = fsm->getState(s_id).log_id;
+        flow.epoch = epoch;
+        if (newFlow != actualFlow) { 
+            // Log for previous flow(to end)
+            Comp_log::endSpan(flow.flow_span);
+            actualFlow = newFlow; 
+            const auto &parameters = actualFlow->getF_parameters();
+            const unsigned int type = log_flow_types[actualFlow->getF_type()];
+            // Flow types have 2 - 4 parameters (buffer size, interval and parameters of the type), shards of a port log it once
+            if (flow.shard == 0) {
+                if (parameters.size() == 2)
+                    flow.flow_span = Comp_log::beginSpan(
+                        actualFlow->log_id, 
+                        this->pid, 
+                        Comp_log::cat_flow, 
+                        {Comp_log::textArg(type), Comp_log::textArg(fsm->log_id), Comp_log::realArg(parameters.at(0)), Comp_log::realArg(parameters.at(1))}
+                    );  
+                else if (parameters.size() == 3)
+                    flow.flow_span = Comp_log::beginSpan(
+                        actualFlow->log_id, 
+                        this->pid, 
+                        Comp_log::cat_flow, 
+                        {Comp_log::textArg(type), Comp_log::textArg(fsm->log_id), Comp_log::realArg(parameters.at(0)), Comp_log::realArg(parameters.at(1)), Comp_log::realArg(parameters.at(2))}
+                    );
+                else
+                    flow.flow_span = Comp_log::beginSpan(
+                        actualFlow->log_id, 
+                        this->pid, 
+                        Comp_log::cat_flow, 
+                        {Comp_log::textArg(type), Comp_log::textArg(fsm->log_id), Comp_log::realArg(parameters.at(0)), Comp_log::realArg(parameters.at(1)), Comp_log::realArg(parameters.at(2)), Comp_log::realArg(parameters.at(3))}
+                    );
             }
-            actualFlow = std::move(flow); 
-            if (actualFlow->getF_type() == Flow_type::simple) {
-                args = {"simple", fsm->getM_name(), std::to_string(actualFlow->getF_parameters().at(0)),std::to_string(actualFlow->getF_parameters().at(1))};
-                Comp_log::Comp_logCreator(
-                    actualFlow->getF_name(), 
-                    this->pid, 
-                    ph_type::BE, 
-                    {"port", "flow"}, 
-                    args
-                );  
-            }else{
-                args = {"on_off", fsm->getM_name(), std::to_string(actualFlow->getF_parameters().at(0)),std::to_string(actualFlow->getF_parameters().at(1)),std::to_string(actualFlow->getF_parameters().at(2)),std::to_string(actualFlow->getF_parameters().at(3))};
-                Comp_log::Comp_logCreator(
-                    actualFlow->getF_name(), 
-                    this->pid, 
-                    ph_type::BE, 
-                    {"port", "flow"}, 
-                    args
-                    
-                );
-                start = std::chrono::steady_clock::now();
-                on_interval = std::chrono::milliseconds(static_cast<int>(actualFlow->getF_parameters().at(2)));
-                off_interval = std::chrono::milliseconds(static_cast<int>(actualFlow->getF_parameters().at(3)));
+            if (actualFlow->getF_type() == Flow_type::on_off) {
+                flow.start = Simulator::steadyNow();
+                flow.on_interval = std::chrono::milliseconds(static_cast<int>(parameters.at(2)));
+                flow.off_interval = std::chrono::milliseconds(static_cast<int>(parameters.at(3)));
             }
-            buffer.resize(actualFlow->getF_parameters().at(0),0);
-            interval = std::chrono::milliseconds(static_cast<int>(actualFlow->integralPart));
-            on_state = true;
+            if (actualFlow->getF_type() == Flow_type::token_bucket)
+                flow.tokens = parameters.at(3); // full bucket
+            flow.burst_left = 0;
+            flow.lag = 0;
+            flow.trace_pos = Trace::header_size; // replay flows start at the first record
+            flow.trace_ts = -1;
+            flow.on_state = true;
+        }
+    }
+    nextPacket(flow);
+    if (flow.shards > 1) { // shard k sends packets k, k + shards, ... of the schedule
+        auto gap = flow.interval;
+        for (unsigned int skipped = 0; skipped < (restarted ? flow.shard : flow.shards - 1); ++skipped) {
+            nextPacket(flow);
+            gap += flow.interval;
         }
-        distribution.param(std::uniform_int_distribution<unsigned int>::param_type(0, actualFlow->getF_parameters().at(0)));
-        randomvalue = distribution(generator);
+        flow.interval = gap;
+    }
 
-        if (actualFlow->getF_type() == Flow_type::on_off){
-            now = std::chrono::steady_clock::now();
-            if (now - start > on_interval && on_state)
-            {
-                on_state = false;
-                start = now;
-            }
-            else if (now - start > off_interval && !on_state)
-            {
-                on_state = true;
-                start = now;
+    if (actualFlow->getF_type() == Flow_type::on_off){
+        auto now = Simulator::steadyNow();
+        if (now - flow.start > flow.on_interval && flow.on_state)
+        {
+            flow.on_state = false;
+            flow.start = now;
+        }
+        else if (now - flow.start > flow.off_interval && !flow.on_state)
+        {
+            flow.on_state = true;
+            flow.start = now;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Draws the size, the value and the time before the next packet of a client port.
+ *
+ * Poisson flows have exponentially distributed times between packets (mean is the interval of the flow),
+ * burst flows send packets of a burst back-to-back (time 0) and bursts every interval. Packets of token_bucket
+ * flows arrive like poisson packets and wait for a token, tokens are added every token time up to the bucket size.
+ * Only the generator of the port is used (no locks or allocations).
+ * 
+ * @param flow The client port.
+ */
+void Component::nextPacket(Client_flow &flow) {
+    Flow &actualFlow = *flow.actualFlow;
+    const auto &parameters = flow.actualFlow->getF_parameters();
+    flow.contents = nullptr;
+    if (actualFlow.getF_type() == Flow_type::replay) {
+        nextRecord(flow);
+        return;
+    }
+    const size_t max_size = actualFlow.getPayload().size();
+    switch (actualFlow.size_distribution) {
+        case Size_distribution::size_uniform:
+            flow.distribution.param(std::uniform_int_distribution<unsigned int>::param_type(actualFlow.size_min, max_size));
+            flow.size = flow.distribution(flow.generator);
+            break;
+        case Size_distribution::size_exponential:
+            flow.size = std::min<double>(flow.exponential(flow.generator) * actualFlow.size_mean, max_size);
+            break;
+        default:
+            flow.size = max_size;
+    }
+    flow.distribution.param(std::uniform_int_distribution<unsigned int>::param_type(0, flow.size));
+    flow.randomvalue = flow.distribution(flow.generator);
+
+    const double mean = actualFlow.interval.count();
+    switch (actualFlow.getF_type()) {
+        case Flow_type::poisson:
+            flow.interval = std::chrono::nanoseconds(std::llround(flow.exponential(flow.generator) * mean));
+            break;
+        case Flow_type::burst:
+            if (flow.burst_left) {
+                --flow.burst_left;
+                flow.interval = std::chrono::nanoseconds(0);
+            } else {
+                flow.burst_left = parameters.at(2) - 1;
+                flow.interval = actualFlow.interval;
             }
+            break;
+        case Flow_type::token_bucket: {
+            const double arrival = flow.exponential(flow.generator) * mean, token = parameters.at(2) * 1000000.0;
+            double gap = std::max(arrival - flow.lag, 0.0); // the packet waits at least until it arrives
+            flow.tokens = token > 0 ? std::min<double>(parameters.at(3), flow.tokens + gap / token) : parameters.at(3);
+            if (flow.tokens < 1) {
+                gap += (1 - flow.tokens) * token;
+                flow.tokens = 0;
+            } else
+                flow.tokens -= 1;
+            flow.lag = std::max(flow.lag + gap - arrival, 0.0);
+            flow.interval = std::chrono::nanoseconds(std::llround(gap));
+            break;
         }
-        #ifdef _WIN32
-            timeBeginPeriod(1);
-        #endif
-        // Thread go sleep for an interval(to send packets in proper time), but can be wake up by change of FSM state(when cv is used lock is unlock for that time), or because of termination. To wake up is need to use cv.notify 
-        if (fsm->cv.wait_for(lock, interval+std::chrono::microseconds(static_cast<int>(actualFlow->fractionalPart)), [&fsm] {
-                    return fsm->changeRequested.load()|| terminateFlag.load();
-                })) {
-                fsm->changeRequested.store(false); // When changerequest or terminateflag, thread see this and store false 
-                continue; // fsm was change so shouldn send next packet
+        default:
+            flow.interval = actualFlow.interval;
+    }
+}
+
+/**
+ * @brief Prepares the next packet of a replay flow from the next record of its capture.
+ *
+ * The time before the packet is the time between the records divided by the speed (speed 0 - no waiting),
+ * the first record (also of every loop) is sent at once. The packet has the size of the record payload and
+ * the usual value and template, with the `contents` option the payload of the record is sent as it is.
+ * At the end of a capture which isn't looped the port stops sending until the flow changes.
+ * 
+ * @param flow The client port.
+ */
+void Component::nextRecord(Client_flow &flow) {
+    Flow &actualFlow = *flow.actualFlow;
+    const auto &parameters = actualFlow.getF_parameters();
+    const unsigned int options = parameters.at(3);
+    Trace::Record record;
+    bool wrapped = false;
+    while (!actualFlow.trace->next(flow.trace_pos, record)) {
+        if (!(options & Flow::replay_loop) || wrapped) { // end of the capture (or a capture without payloads)
+            flow.on_state = false;
+            flow.interval = std::chrono::hours(1); // checked again only after a state change or an hour
+            return;
         }
-        // Fill buffer with data
-        std::string msg = std::to_string(randomvalue);
-        std::fill(buffer.begin(), buffer.end(), 0); 
-        std::copy(msg.begin(), msg.end(), buffer.begin());
-        if (on_state){ // Send only in proper state.(on/off feature)
+        flow.trace_pos = Trace::header_size;
+        flow.trace_ts = -1;
+        wrapped = true;
+    }
+    const double speed = parameters.at(2);
+    flow.interval = std::chrono::nanoseconds(0);
+    if (flow.trace_ts >= 0 && speed > 0)
+        flow.interval = std::chrono::nanoseconds(std::llround(std::max(record.ts - flow.trace_ts, 0LL) / speed));
+    flow.trace_ts = record.ts;
+    flow.on_state = true;
+    if (options & Flow::replay_contents) {
+        flow.contents = record.data;
+        flow.size = record.size;
+        flow.randomvalue = 0;
+        return;
+    }
+    flow.size = std::min(record.size, actualFlow.getPayload().size());
+    flow.distribution.param(std::uniform_int_distribution<unsigned int>::param_type(0, flow.size));
+    flow.randomvalue = flow.distribution(flow.generator);
+}
+
+/**
+ * @brief Sends prepared packets of a client port (called by the flow scheduler at the deadline).
+ *
+ * The message value is a random number uniformly distributed within the packet size, written at the start of the packet.
+ * The rest of the packet is the immutable template of the flow, so only the header (`Flow::header_size` bytes)
+ * is written per packet. Every packet is logged and the next one is prepared after it. Headers of a batch are
+ * written one after another into `flow.batch` and sent together by `transmitPackets`. Packets are added to the batch
+ * while their deadlines are before the horizon.
+ * 
+ * @param flow The client port.
+ * @param deadline Deadline of the first packet, moved to the deadline of the next packet which isn't sent.
+ * @param horizon Packets with an earlier deadline are sent now (the first one always).
+ * @param max_count Maximum number of packets (more than 1 only for UDP ports).
+ * @return false if the port has to be closed (the actual state has no valid flow).
+ */
+bool Component::sendPackets(Client_flow &flow, std::chrono::steady_clock::time_point &deadline,
+                            std::chrono::steady_clock::time_point horizon, unsigned int max_count) {
+    if (flow.batch.size() < max_count * Flow::header_size) {
+        flow.batch.resize(max_count * Flow::header_size);
+        flow.packets.resize(max_count);
+    }
+    unsigned int staged = 0;
+    bool open = true;
+    for (unsigned int i = 0; i < max_count && (i == 0 || deadline < horizon); ++i) {
+        if (flow.on_state) { // Send only in proper state.(on/off feature)
+            if (flow.contents) // data of the capture
+                flow.packets[staged++] = Packet_slice{0, flow.contents, flow.size};
+            else {
+                // Write the value into the header, the rest of the header is zero like the template
+                char *header = flow.batch.data() + staged * Flow::header_size;
+                const size_t header_size = std::min(flow.size, Flow::header_size);
+                flow.packets[staged++] = Packet_slice{header_size, flow.actualFlow->getPayload().data(), flow.size - header_size};
+                char msg[16]; // value written without allocation
+                int length = std::snprintf(msg, sizeof(msg), "%u", flow.randomvalue);
+                std::copy(msg, msg + length, header);
+                std::fill(header + length, header + Flow::header_size, 0);
+            }
             Comp_log::Comp_logCreator(
-                p_name, 
+                flow.port->log_id, 
                 this->pid, 
                 ph_type::I, 
-                {"port", "packet", "packet_snd"}, 
-                {listenFlag ? "TCP" : "UDP", fsm->getM_name(), fsm->getS_name(), std::to_string(randomvalue)}
+                Comp_log::cat_packet_snd, 
+                {Comp_log::textArg(flow.listenFlag ? log_TCP : log_UDP), Comp_log::textArg(flow.fsm->log_id), Comp_log::textArg(flow.state_log_id), Comp_log::numberArg(flow.randomvalue)}
             );
+        }
+        open = prepareFlow(flow);
+        deadline += flow.interval;
+        if (!open)
+            break;
+    }
+    transmitPackets(flow, staged);
+    return open;
+}
 
-            int sent_bytes;
-            if (listenFlag)
-                sent_bytes = send(client_socket, buffer.data(), buffer.size(), 0);
+/**
+ * @brief Sends staged packets of a client port.
+ *
+ * Every packet is its header from `flow.batch` followed by its body, the template of the flow or data of a capture
+ * (vectored I/O, nothing is copied).
+ * On Linux a UDP batch is sent with one call: packets of the same size as one buffer split by the kernel into datagrams
+ * (UDP GSO, `UDP_SEGMENT`), otherwise with `sendmmsg`. Elsewhere (and for TCP) packets are sent one by one.
+ * With io_uring packets are queued in the ring of the pacing thread instead (`queuePackets`).
+ * 
+ * @param flow The client port.
+ * @param count Number of packets in `flow.packets`.
+ */
+void Component::transmitPackets(Client_flow &flow, unsigned int count) {
+    int sent_bytes = 0;
+    if (Simulator::enabled) { // only the value is read by the receiver
+        for (unsigned int i = 0; i < count; ++i)
+            if (flow.packets[i].header_size)
+                Simulator::send(flow.listenFlag, flow.server_addr, flow.batch.data() + i * Flow::header_size, flow.packets[i].header_size);
             else
-                sent_bytes = sendto(client_socket, buffer.data(), buffer.size(), 0, reinterpret_cast<const sockaddr *>(&server_addr), sizeof(server_addr));
-            
-            if (sent_bytes == -1)
-                std::cerr<<"["<<c_name <<" (" << pid << ")] Client "<<p_name<<" error sending data" << std::endl;
+                Simulator::send(flow.listenFlag, flow.server_addr, flow.packets[i].body, std::min(flow.packets[i].body_size, Flow::header_size));
+        return;
+    }
+#ifdef USE_IO_URING
+    if (flow.ring && !flow.zerocopy) { // zero copy sends keep system calls (completions are read from the error queue)
+        queuePackets(flow, count, flow.gso);
+        return;
+    }
+#endif
+#ifdef __linux__
+    if (!flow.listenFlag && count > 1) {
+        iovec iovs[2 * Flow_scheduler::max_batch];
+        size_t total = 0;
+        bool same_size = true;
+        for (unsigned int i = 0; i < count; ++i) {
+            const Packet_slice &packet = flow.packets[i];
+            iovs[2 * i] = {flow.batch.data() + i * Flow::header_size, packet.header_size};
+            iovs[2 * i + 1] = {const_cast<char *>(packet.body), packet.body_size};
+            total += packet.header_size + packet.body_size;
+            same_size = same_size && packet.header_size + packet.body_size == flow.packets[0].header_size + flow.packets[0].body_size;
         }
-        #ifdef _WIN32
-            timeEndPeriod(1);
-        #endif
+        if (flow.gso && same_size && total <= 65000) {
+            char control[CMSG_SPACE(sizeof(uint16_t))] = {};
+            msghdr msg = {};
+            msg.msg_name = &flow.server_addr;
+            msg.msg_namelen = sizeof(flow.server_addr);
+            msg.msg_iov = iovs;
+            msg.msg_iovlen = 2 * count;
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+            cmsghdr *segment = CMSG_FIRSTHDR(&msg);
+            segment->cmsg_level = SOL_UDP;
+            segment->cmsg_type = UDP_SEGMENT;
+            segment->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            uint16_t segment_size = flow.packets[0].header_size + flow.packets[0].body_size;
+            std::memcpy(CMSG_DATA(segment), &segment_size, sizeof(segment_size));
+            if (sendmsg(flow.socket, &msg, 0) >= 0)
+                return;
+            if (gsoUnsupported(errno))
+                flow.gso = false; // otherwise only this batch is sent by sendmmsg
+        }
+        mmsghdr msgs[Flow_scheduler::max_batch] = {};
+        for (unsigned int i = 0; i < count; ++i) {
+            msgs[i].msg_hdr.msg_name = &flow.server_addr;
+            msgs[i].msg_hdr.msg_namelen = sizeof(flow.server_addr);
+            msgs[i].msg_hdr.msg_iov = &iovs[2 * i];
+            msgs[i].msg_hdr.msg_iovlen = 2;
+        }
+        for (unsigned int sent = 0; sent < count; ) {
+            int result = sendmmsg(flow.socket, msgs + sent, count - sent, 0);
+            if (result <= 0) {
+                sent_bytes = -1;
+                break;
+            }
+            sent += result;
+        }
+        count = 0;
+    }
+#endif
+    for (unsigned int i = 0; i < count && sent_bytes != -1; ++i) {
+        const Packet_slice &packet = flow.packets[i];
+        sent_bytes = sendPacket(flow, flow.batch.data() + i * Flow::header_size, packet.header_size, packet.body, packet.body_size);
     }
-    // Close client socket
-    cleanupSocket(client_socket,p_name);
+    if (sent_bytes == -1)
+        std::cerr<<"["<<c_name <<" (" << pid << ")] Client "<<flow.port->getP_name()<<" error sending data" << std::endl;
 }
 
+/**
+ * @brief Sends one packet made of a header and a body.
+ *
+ * Large TCP packets are sent with `MSG_ZEROCOPY` if it is enabled for the port (`--zerocopy`): the header is copied
+ * by the kernel and the body, the immutable template of the flow (or the mapped capture), is sent from its pages,
+ * so it's never copied.
+ * 
+ * @return Number of bytes sent or -1.
+ */
+int Component::sendPacket(Client_flow &flow, const char *header, size_t header_size, const char *body, size_t body_size) {
+#ifdef _WIN32
+    WSABUF bufs[2] = {{static_cast<ULONG>(header_size), const_cast<char *>(header)}, {static_cast<ULONG>(body_size), const_cast<char *>(body)}};
+    DWORD sent = 0;
+    int result;
+    if (flow.listenFlag)
+        result = WSASend(flow.socket, bufs, body_size ? 2 : 1, &sent, 0, NULL, NULL);
+    else
+        result = WSASendTo(flow.socket, bufs, body_size ? 2 : 1, &sent, 0, reinterpret_cast<const sockaddr *>(&flow.server_addr), sizeof(flow.server_addr), NULL, NULL);
+    return result == 0 ? static_cast<int>(sent) : -1;
+#else
+    #ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL; // socket can be shut down by terminate
+    #else
+    const int flags = 0;
+    #endif
+#ifdef __linux__
+    if (flow.zerocopy && header_size + body_size >= Flow_scheduler::zerocopy_min && body_size) {
+        if (header_size && send(flow.socket, header, header_size, flags | MSG_MORE) < 0)
+            return -1;
+        ssize_t result = send(flow.socket, body, body_size, flags | MSG_ZEROCOPY);
+        if (result >= 0)
+            ++flow.zerocopy_pending;
+        else if (errno == ENOBUFS) // pinned memory limit of the socket
+            result = send(flow.socket, body, body_size, flags);
+        if (flow.zerocopy_pending)
+            reapZerocopy(flow);
+        return result < 0 ? -1 : static_cast<int>(header_size + result);
+    }
+#endif
+    iovec iov[2] = {{const_cast<char *>(header), header_size}, {const_cast<char *>(body), body_size}};
+    msghdr msg = {};
+    if (!flow.listenFlag) {
+        msg.msg_name = &flow.server_addr;
+        msg.msg_namelen = sizeof(flow.server_addr);
+    }
+    msg.msg_iov = iov;
+    msg.msg_iovlen = body_size ? 2 : 1;
+    return sendmsg(flow.socket, &msg, flags);
+#endif
+}
+
+#ifdef USE_IO_URING
+/**
+ * @brief Queues staged packets of a client port in the ring of its pacing thread.
+ *
+ * Packets are sent by `Flow_scheduler::flush` together with packets of other ports of the pacing thread.
+ * Like in `transmitPackets` a UDP batch of packets of the same size is one UDP GSO message, otherwise every packet
+ * is a message. TCP messages are sent whole (`MSG_WAITALL`), as by a blocking send.
+ * 
+ * @param flow The client port.
+ * @param count Number of packets in `flow.packets`.
+ * @param gso Packets of the same size can be sent as one UDP GSO message.
+ */
+void Component::queuePackets(Client_flow &flow, unsigned int count, bool gso) {
+    if (flow.ring_msgs.size() < count) {
+        flow.ring_msgs.resize(std::max(count, Flow_scheduler::max_batch));
+        flow.ring_iovs.resize(2 * flow.ring_msgs.size());
+    }
+    size_t total = 0;
+    bool same_size = true;
+    for (unsigned int i = 0; i < count; ++i) {
+        const Packet_slice &packet = flow.packets[i];
+        flow.ring_iovs[2 * i] = {flow.batch.data() + i * Flow::header_size, packet.header_size};
+        flow.ring_iovs[2 * i + 1] = {const_cast<char *>(packet.body), packet.body_size};
+        total += packet.header_size + packet.body_size;
+        same_size = same_size && packet.header_size + packet.body_size == flow.packets[0].header_size + flow.packets[0].body_size;
+    }
+    flow.ring_count = count;
+    flow.ring_gso = !flow.listenFlag && count > 1 && gso && same_size && total <= 65000;
+    flow.ring_failed = false;
+    const unsigned int messages = flow.ring_gso ? 1 : count;
+    for (unsigned int i = 0; i < messages; ++i) {
+        msghdr &msg = flow.ring_msgs[i];
+        msg = msghdr();
+        if (!flow.listenFlag) {
+            msg.msg_name = &flow.server_addr;
+            msg.msg_namelen = sizeof(flow.server_addr);
+        }
+        msg.msg_iov = &flow.ring_iovs[2 * i];
+        msg.msg_iovlen = flow.ring_gso ? 2 * count : 2;
+        if (flow.ring_gso) {
+            msg.msg_control = flow.ring_control;
+            msg.msg_controllen = sizeof(flow.ring_control);
+            cmsghdr *segment = CMSG_FIRSTHDR(&msg);
+            segment->cmsg_level = SOL_UDP;
+            segment->cmsg_type = UDP_SEGMENT;
+            segment->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            uint16_t segment_size = flow.packets[0].header_size + flow.packets[0].body_size;
+            std::memcpy(CMSG_DATA(segment), &segment_size, sizeof(segment_size));
+        }
+        io_uring_sqe *sqe = flow.ring->sqe();
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = flow.socket;
+        sqe->addr = reinterpret_cast<uint64_t>(&msg);
+        sqe->len = 1;
+        sqe->msg_flags = MSG_NOSIGNAL | (flow.listenFlag ? MSG_WAITALL : 0);
+        sqe->user_data = reinterpret_cast<uint64_t>(&flow);
+        ++flow.ring->inflight;
+    }
+}
+
+/**
+ * @brief Handles the completion of a message queued by `queuePackets`.
+ *
+ * A failed UDP GSO message is queued again as one message per packet (UDP GSO is turned off for the port
+ * only if it isn't supported), other errors are printed once per batch.
+ */
+void Component::packetsSent(Client_flow &flow, int result) {
+    if (result >= 0)
+        return;
+    if (flow.ring_gso) {
+        if (gsoUnsupported(-result))
+            flow.gso = false;
+        queuePackets(flow, flow.ring_count, false);
+        return;
+    }
+    if (!flow.ring_failed) {
+        flow.ring_failed = true;
+        std::cerr<<"["<<c_name <<" (" << pid << ")] Client "<<flow.port->getP_name()<<" error sending data" << std::endl;
+    }
+}
+#endif
+
+#ifdef __linux__
+/**
+ * @brief Reads completions of `MSG_ZEROCOPY` sends from the error queue of the socket (without waiting).
+ *
+ * Bodies are templates of flows which are never changed, so completions only have to be removed from the queue.
+ * If the kernel copied the data anyway (for example on loopback), zero copy is turned off for the port,
+ * because it only adds the cost of completions.
+ */
+void Component::reapZerocopy(Client_flow &flow) {
+    char control[128];
+    msghdr msg = {};
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    while (recvmsg(flow.socket, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) >= 0) {
+        for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level != SOL_IP || cmsg->cmsg_type != IP_RECVERR)
+                continue;
+            sock_extended_err err;
+            std::memcpy(&err, CMSG_DATA(cmsg), sizeof(err));
+            if (err.ee_errno != 0 || err.ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+                continue;
+            flow.zerocopy_pending -= std::min<unsigned long long>(flow.zerocopy_pending, err.ee_data - err.ee_info + 1);
+            if (err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+                flow.zerocopy = false;
+        }
+        msg.msg_controllen = sizeof(control);
+    }
+}
+#endif
+
 /**
  * @brief Computes the number of seconds until a specified time.
  *
@@ -687,42 +1539,55 @@ int Component::seconds_until(const std::string& target_time_str) {
 /**
  * @brief Starts the flow for the component.
  *
- * This method starts new threads for each port in the component.
+ * This method starts a task of the executor for each port in the component.
  * 
  * @param target_time_str Specifies the time when client ports should start operating (in the format h:m:s).
  */
 void Component::startFlow(const std::string target_time_str)
 {
-    // Need to lock because futures is multithread variable.
-    std::unique_lock<std::mutex> lock(fut_mtx);
     for (auto& port : pnames_ports){
         if (port.second->getP_type() == Port_type::s)
         {
-            if (port.second->getP_transport() == Transport_type::U)
-                futures.push_back(std::async(std::launch::async, &Component::setupServerSocket, this,port.second,false));
-            else if (port.second->getP_transport() == Transport_type::T)
-                futures.push_back(std::async(std::launch::async, &Component::setupServerSocket, this,port.second,true));
+            std::shared_ptr<Port> serverPort = port.second;
+            if (serverPort->getP_transport() == Transport_type::U)
+                Executor::submit([this, serverPort]() { setupServerSocket(serverPort, false); });
+            else if (serverPort->getP_transport() == Transport_type::T)
+                Executor::submit([this, serverPort]() { setupServerSocket(serverPort, true); });
         }
     }
     
 
     
     std::cout<<"["<<c_name <<" (" << pid << ")] Client will start operating at "<<target_time_str<< std::endl;
+    if (Simulator::enabled) { // The start time is reached in virtual time
+        Simulator::schedule(Simulator::now() + seconds_until(target_time_str) * 1000000000LL, [this]() { startClients(); });
+        return;
+    }
     // Go sleep for specify time or can be terminate.
+    std::unique_lock<std::mutex> lock(comp_mtx);
     if (comp_cv.wait_for(lock, std::chrono::seconds(seconds_until(target_time_str)), [] {return terminateFlag.load();})){
         std::cout<<"["<<c_name <<" (" << pid << ")] Terminate starting clients\n";
             return;
     }
     // Start mqtt client
     client_.start_consuming();
-
+    startClients();
+}
+/**
+ * @brief Starts client ports of the component (at the start time).
+ */
+void Component::startClients()
+{
+    if (Simulator::enabled)
+        Simulator::startRun();
     for (auto& port : pnames_ports)
     {
         if (port.second->getP_type() == Port_type::c){
-            if (port.second->getP_transport() == Transport_type::U)
-                futures.push_back(std::async(std::launch::async, &Component::setupClientSocket, this,port.second,false));
-            else if (port.second->getP_transport() == Transport_type::T)
-                futures.push_back(std::async(std::launch::async, &Component::setupClientSocket, this,port.second,true));
+            std::shared_ptr<Port> clientPort = port.second;
+            if (clientPort->getP_transport() == Transport_type::U)
+                Executor::submit([this, clientPort]() { setupClientSocket(clientPort, false); });
+            else if (clientPort->getP_transport() == Transport_type::T)
+                Executor::submit([this, clientPort]() { setupClientSocket(clientPort, true); });
         }
     }
 }
\ No newline at end of file
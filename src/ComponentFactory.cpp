@@ -10,7 +10,11 @@ std::unordered_map<std::string, E_type> etypemap= {
     {"l", E_type::l}};
 std::unordered_map<std::string, Flow_type> flowtypemap= {
     {"simple", Flow_type::simple},
-    {"on_off", Flow_type::on_off}};
+    {"on_off", Flow_type::on_off},
+    {"poisson", Flow_type::poisson},
+    {"burst", Flow_type::burst},
+    {"token_bucket", Flow_type::token_bucket},
+    {"replay", Flow_type::replay}};
 std::unordered_map<std::string, Port_type> porttypemap= {
     {"c", Port_type::c},
     {"s", Port_type::s}};
@@ -163,11 +167,97 @@ void ComponentFactory::fsmsCreator(const std::string& value,
                     continue;
                 }
                 initial = Helper_functions::getTokenAtIndex(fsm,2); 
+                if (sname_statesptr.find(initial) == sname_statesptr.end()) {
+                    std::cerr<<"["<<c_name <<" (" << pid << ")] INITIAL STATE (" << initial << ") NOT FOUND FOR FSM "<< m_name << std::endl;
+                    continue;
+                }
                 mname_fsmsptr[m_name] = std::make_shared<Fsm>(m_name,sname_statesptr,initial);
 
         }
     }
 }
+/**
+ * @brief Compiles the FSMs of the component into integer-indexed tables.
+ *
+ * Events get dense ids of the component and states dense ids of their FSM. Every FSM gets a flat
+ * state x event table of transitions with resolved actions, so an incoming event is dispatched without
+ * name lookups. Transitions with unknown events or target states are reported and left out.
+ */
+void ComponentFactory::fsmsCompiler(const std::string& c_name, const std::string& pid) {
+    unsigned int e_id = 0;
+    for (auto &event : ename_eventsptr)
+        event.second->id = e_id++;
+    const size_t event_count = ename_eventsptr.size();
+
+    for (auto &fsmEntry : mname_fsmsptr) {
+        auto &fsm = fsmEntry.second;
+        std::vector<std::shared_ptr<State>> states;
+        for (auto &state : fsm->getStates()) {
+            state.second->id = states.size();
+            states.push_back(state.second);
+        }
+        std::vector<Fsm::Compiled_state> compiled_states(states.size());
+        std::vector<Fsm::Compiled_transition> table(states.size() * event_count, Fsm::Compiled_transition{Fsm::no_transition, {}});
+        for (auto &state : states) {
+            compiled_states[state->id].on_entry = actionsCompiler(state->getOn_entry(), fsmEntry.first, c_name, pid);
+            compiled_states[state->id].on_exit = actionsCompiler(state->getOn_exit(), fsmEntry.first, c_name, pid);
+            for (auto &transitionEntry : state->getTransitions()) {
+                auto &transition = transitionEntry.second;
+                auto event = ename_eventsptr.find(transition->getE_name());
+                auto target = fsm->getStates().find(transition->getS_name());
+                if (event == ename_eventsptr.end()) {
+                    std::cerr<<"["<<c_name <<" (" << pid << ")] TRANSITION WITH UNKNOWN EVENT (" << transition->getE_name() << ") IN FSM "<< fsmEntry.first << std::endl;
+                    continue;
+                }
+                if (target == fsm->getStates().end()) {
+                    std::cerr<<"["<<c_name <<" (" << pid << ")] TRANSITION TO UNKNOWN STATE (" << transition->getS_name() << ") IN FSM "<< fsmEntry.first << std::endl;
+                    continue;
+                }
+                Fsm::Compiled_transition &compiled = table[state->id * event_count + event->second->id];
+                compiled.target = target->second->id;
+                compiled.actions = actionsCompiler(transition->getActions(), fsmEntry.first, c_name, pid);
+            }
+        }
+        unsigned int initial_id = fsm->getStates().at(fsm->getInitial())->id;
+        fsm->setTable(std::move(states), std::move(compiled_states), std::move(table), event_count, initial_id);
+    }
+}
+/**
+ * @brief Maps state ids of the FSM of every client port to flows (after `fsmsCompiler`).
+ *
+ * The packet loop of a client port then finds the flow of the actual state by indexing.
+ */
+void ComponentFactory::portsCompiler(const std::string& c_name, const std::string& pid) {
+    for (auto &portEntry : pname_portsptr) {
+        auto client_info = portEntry.second->getClient_info();
+        if (!client_info)
+            continue;
+        auto fsm = mname_fsmsptr.find(client_info->getM_name());
+        if (fsm == mname_fsmsptr.end()) {
+            std::cerr<<"["<<c_name <<" (" << pid << ")] FSM (" << client_info->getM_name() << ") NOT FOUND FOR PORT "<< portEntry.first << std::endl;
+            continue;
+        }
+        std::vector<std::shared_ptr<Flow>> sid_flows(fsm->second->getState_count());
+        for (auto &state : fsm->second->getStates())
+            sid_flows[state.second->id] = client_info->getFlow(state.first);
+        client_info->setState_flows(std::move(sid_flows));
+    }
+}
+//Resolves names of actions to events of the component (unknown actions are reported and left out).
+std::vector<Event *> ComponentFactory::actionsCompiler(const std::vector<std::string>& actions,
+                                                      const std::string& m_name,
+                                                      const std::string& c_name,
+                                                      const std::string& pid) {
+    std::vector<Event *> events;
+    for (auto &action : actions) {
+        auto event = ename_eventsptr.find(action);
+        if (event == ename_eventsptr.end())
+            std::cerr<<"["<<c_name <<" (" << pid << ")] UNKNOWN ACTION (" << action << ") IN FSM "<< m_name << std::endl;
+        else
+            events.push_back(event->second.get());
+    }
+    return events;
+}
 std::unordered_map<std::string, std::shared_ptr<State>> ComponentFactory::statesCreator(const std::string& value, 
                                     const std::vector<std::string>& list, 
                                     const std::string& c_name, 
@@ -250,7 +340,7 @@ void ComponentFactory::flowsCreator(const std::string& value,
         std::cerr<<"["<<c_name <<" (" << pid << ")] NO FLOWS FOR COMPONENT"<<std::endl;
     else{
         std::string flow,f_name,flow_instance_s;
-        std::pair<Flow_type, std::vector<float>> flow_instance;
+        std::shared_ptr<Flow> flow_instance;
         for (int& index: flows_index){
                 flow = list.at(index); // f_name;!number where !number => <flow_anonymous>(always only one)
                 f_name = Helper_functions::getTokenAtIndex(flow,0);
@@ -261,9 +351,9 @@ void ComponentFactory::flowsCreator(const std::string& value,
                 flow_instance_s = Helper_functions::getTokenAtIndex(flow,1);
                 flow_instance_s= list.at(findNumbers(flow_instance_s).at(0)); //Flowtype;Buffersize;interval;on_interval;off_interval(last 2 depends on flowtype)
                 flow_instance = ComponentFactory::flowanonymousCreator(flow_instance_s,c_name,pid,f_name);
-                if (flow_instance.second.empty())
+                if (!flow_instance)
                     continue;
-                ComponentFactory::fname_flowsptr[f_name] = std::make_shared<Flow>(flow_instance.first,flow_instance.second,f_name);
+                ComponentFactory::fname_flowsptr[f_name] = flow_instance;
         }
     }
 }
@@ -280,7 +370,7 @@ void ComponentFactory::portsCreator(const std::string& value,
         Port_type p_type;
         Transport_type p_transport;
         for (int& index: ports_index){
-                port = list.at(index); //p_name;port_type;transport_type;local_end;remote_end;m_name(fsm);stateflow
+                port = list.at(index); //p_name;port_type;transport_type;local_end;remote_end;m_name(fsm);stateflow;parallelism(optional)
                 p_name = Helper_functions::getTokenAtIndex(port,0); //p_name
                 if (pname_portsptr.find(p_name) != pname_portsptr.end()) { 
                     std::cerr<<"["<<c_name <<" (" << pid << ")] PORT (" << p_name << ") DUPLICATE"<<std::endl;
@@ -328,7 +418,18 @@ std::shared_ptr<Port> ComponentFactory::createPort(const std::string& p_name,
             std::cerr << "[" << c_name << " (" << pid << ")] NO STATES_FLOWS FOR PORT " << p_name << std::endl;
             return nullptr;
         } 
-        return std::make_shared<Port>(p_name, p_type, p_transport, localIP, localPort, std::make_shared<Client_info>(remoteIP, std::stoi(remotePort), m_name, sname_flow));
+        // Optional parallelism: the flow is sent by this number of sockets
+        std::string parallelism_s = Helper_functions::getTokenAtIndex(port, 7);
+        unsigned long parallelism = 1;
+        if (!parallelism_s.empty()) {
+            char *end;
+            parallelism = std::strtoul(parallelism_s.c_str(), &end, 10);
+            if (*end || parallelism < 1 || parallelism > 1024) {
+                std::cerr << "[" << c_name << " (" << pid << ")] INVALID PARALLELISM OF PORT " << p_name << std::endl;
+                return nullptr;
+            }
+        }
+        return std::make_shared<Port>(p_name, p_type, p_transport, localIP, localPort, std::make_shared<Client_info>(remoteIP, std::stoi(remotePort), m_name, sname_flow, parallelism));
     }
 }
 
@@ -346,59 +447,166 @@ std::unordered_map<std::string, std::shared_ptr<Flow>> ComponentFactory::statefl
         if (findNumbers(flow_instance_s).empty())
             sname_flow[s_name] = ComponentFactory::fname_flowsptr.at(flow_instance_s); //Change to s_name;f_name -> sname_flow map s_name -> flow_ptr
         else{//create new anonymous flow
-            std::pair<Flow_type, std::vector<float>> flow_instance;
             flow_instance_s = list.at(findNumbers(flow_instance_s).at(0));//
-            flow_instance = flowanonymousCreator(flow_instance_s,c_name,pid); //Flowtype;Buffersize;interval;on_interval;off_interval(last 2 depends on flowtype)
-            if (flow_instance.second.empty())
+            std::shared_ptr<Flow> flow_instance = flowanonymousCreator(flow_instance_s,c_name,pid); //Flowtype;Buffersize;interval;parameters of the type
+            if (!flow_instance)
                 continue;
-            sname_flow[s_name] = std::make_shared<Flow>(flow_instance.first,flow_instance.second);
+            sname_flow[s_name] = flow_instance;
         }
     }
     return sname_flow;
 }
-std::pair<Flow_type, std::vector<float>> ComponentFactory::flowanonymousCreator(const std::string& value,
-                                                                            const std::string&c_name,
-                                                                            const std::string& pid,
-                                                                            const std::string& f_name){
-    std::pair<Flow_type, std::vector<float>> FlowAnonymous;
-    Flow_type f_type;
-    float arg1,arg2;
-    f_type = flowtypemap.at(Helper_functions::getTokenAtIndex(value,0));
-    arg1 = std::stof(Helper_functions::getTokenAtIndex(value,1));
-    if (arg1<0){
-        std::cerr<<"["<<c_name <<" (" << pid << ")] PROBLEM IN BUFFERSIZE FLOW: "<<f_name<< std::endl;
-        return FlowAnonymous;
-        
+/**
+ * @brief Parses the buffer size of a flow.
+ *
+ * The size is a number (every packet has this size), `min-max` (uniformly distributed sizes)
+ * or `~mean` (exponentially distributed sizes, limited to 10 times the mean and the maximum UDP payload).
+ *
+ * @param max The largest size of a packet (size of the template of the flow).
+ * @return false if the size is invalid.
+ */
+bool ComponentFactory::parseSize(const std::string& value, Size_distribution& distribution, float& min, float& mean, float& max) {
+    try {
+        size_t range = value.find('-', 1);
+        if (!value.empty() && value[0] == '~') {
+            distribution = Size_distribution::size_exponential;
+            mean = std::stof(value.substr(1));
+            min = 0;
+            max = std::min(mean * 10, 65507.0f);
+        } else if (range != std::string::npos) {
+            distribution = Size_distribution::size_uniform;
+            min = std::stof(value.substr(0, range));
+            max = std::stof(value.substr(range + 1));
+            mean = (min + max) / 2;
+        } else {
+            distribution = Size_distribution::size_fixed;
+            min = mean = max = std::stof(value);
+        }
+    } catch (const std::exception&) {
+        return false;
     }
-    arg2 = parseTimeout(Helper_functions::getTokenAtIndex(value,2),c_name,pid,f_name);
+    return min >= 0 && mean >= min && max >= mean;
+}
+/**
+ * @brief Creates a flow from its description: Flowtype;Buffersize;interval;parameters of the type.
+ *
+ * Parameters of types: on_off - on_interval;off_interval, burst - packets of a burst,
+ * token_bucket - time of one token;bucket size (packets). The interval of poisson and token_bucket flows
+ * is the mean time between packets. Replay flows have another form (see `replayCreator`).
+ *
+ * @return The flow or nullptr if the description is invalid.
+ */
+std::shared_ptr<Flow> ComponentFactory::flowanonymousCreator(const std::string& value,
+                                                            const std::string&c_name,
+                                                            const std::string& pid,
+                                                            const std::string& f_name){
+    const std::string object = f_name.empty() ? "Anonymous Flow" : f_name;
+    auto type = flowtypemap.find(Helper_functions::getTokenAtIndex(value,0));
+    if (type == flowtypemap.end()){
+        std::cerr<<"["<<c_name <<" (" << pid << ")] UNKNOWN TYPE OF FLOW: "<<object<< std::endl;
+        return nullptr;
+    }
+    Flow_type f_type = type->second;
+    if (f_type == Flow_type::replay)
+        return replayCreator(value,c_name,pid,f_name);
+    Size_distribution size_distribution;
+    float arg1,arg2,size_min,size_mean;
+    if (!parseSize(Helper_functions::getTokenAtIndex(value,1), size_distribution, size_min, size_mean, arg1)){
+        std::cerr<<"["<<c_name <<" (" << pid << ")] PROBLEM IN BUFFERSIZE FLOW: "<<object<< std::endl;
+        return nullptr;
+    }
+    arg2 = parseTimeout(Helper_functions::getTokenAtIndex(value,2),c_name,pid,object);
     if (arg2<0){
-        std::cerr<<"["<<c_name <<" (" << pid << ")] PROBLEM IN INTERVAL FLOW: "<<f_name<<std::endl;
-        return FlowAnonymous;
+        std::cerr<<"["<<c_name <<" (" << pid << ")] PROBLEM IN INTERVAL FLOW: "<<object<<std::endl;
+        return nullptr;
     }
+    std::vector<float> parameters{arg1,arg2};
     if (f_type == Flow_type::on_off){
         float arg3,arg4;
 
-        arg3 = parseTimeout(Helper_functions::getTokenAtIndex(value,3),c_name,pid,f_name);
+        arg3 = parseTimeout(Helper_functions::getTokenAtIndex(value,3),c_name,pid,object);
         if (arg3<0){
-            std::cerr<<"["<<c_name <<" (" << pid << ")] PROBLEM IN ON_INTERVAL FLOW: "<<f_name<<std::endl;
-            return FlowAnonymous;
+            std::cerr<<"["<<c_name <<" (" << pid << ")] PROBLEM IN ON_INTERVAL FLOW: "<<object<<std::endl;
+            return nullptr;
         }
-        arg4 = parseTimeout(Helper_functions::getTokenAtIndex(value,4),c_name,pid,f_name);
+        arg4 = parseTimeout(Helper_functions::getTokenAtIndex(value,4),c_name,pid,object);
         if (arg4<0){
-            std::cerr<<"["<<c_name <<" (" << pid << ")] PROBLEM IN OFF_INTERVAL FLOW: "<<f_name<<std::endl;
-            return FlowAnonymous;
+            std::cerr<<"["<<c_name <<" (" << pid << ")] PROBLEM IN OFF_INTERVAL FLOW: "<<object<<std::endl;
+            return nullptr;
         }
         if (arg1>arg3){
-            std::cerr<<"["<<c_name <<" (" << pid << ")] INTERVAL GREATER THAN ON_INTERVAL FLOW: "<<f_name<<std::endl;
-            return FlowAnonymous;
+            std::cerr<<"["<<c_name <<" (" << pid << ")] INTERVAL GREATER THAN ON_INTERVAL FLOW: "<<object<<std::endl;
+            return nullptr;
         }
-        FlowAnonymous.second = std::vector<float>{arg1,arg2,arg3,arg4};
-
-    }else
-        FlowAnonymous.second = std::vector<float>{arg1,arg2};
+        parameters.insert(parameters.end(), {arg3,arg4});
+    }else if (f_type == Flow_type::burst){
+        float packets = std::strtof(Helper_functions::getTokenAtIndex(value,3).c_str(), nullptr);
+        if (packets<1){
+            std::cerr<<"["<<c_name <<" (" << pid << ")] PROBLEM IN BURST SIZE FLOW: "<<object<<std::endl;
+            return nullptr;
+        }
+        parameters.push_back(std::floor(packets));
+    }else if (f_type == Flow_type::token_bucket){
+        float token = parseTimeout(Helper_functions::getTokenAtIndex(value,3),c_name,pid,object);
+        float bucket = std::strtof(Helper_functions::getTokenAtIndex(value,4).c_str(), nullptr);
+        if (token<0 || bucket<1){
+            std::cerr<<"["<<c_name <<" (" << pid << ")] PROBLEM IN TOKEN BUCKET FLOW: "<<object<<std::endl;
+            return nullptr;
+        }
+        parameters.insert(parameters.end(), {token,bucket});
+    }
 
-    FlowAnonymous.first = f_type;
-    return FlowAnonymous;
+    auto flow = std::make_shared<Flow>(f_type,parameters,f_name);
+    flow->size_distribution = size_distribution;
+    flow->size_min = size_min;
+    flow->size_mean = size_mean;
+    return flow;
+}
+/**
+ * @brief Creates a replay flow: replay;path of a pcap capture;speed;options.
+ *
+ * Speed multiplies the pace of the capture (default 1, 0 - packets without waiting),
+ * options are `loop` (the capture starts again at its end) and `contents` (payloads of the capture are sent
+ * instead of the value and zeros), joined by `+`. The capture is mapped, not read.
+ *
+ * @return The flow or nullptr if the capture can't be read.
+ */
+std::shared_ptr<Flow> ComponentFactory::replayCreator(const std::string& value,
+                                                    const std::string&c_name,
+                                                    const std::string& pid,
+                                                    const std::string& f_name){
+    const std::string object = f_name.empty() ? "Anonymous Flow" : f_name;
+    std::string error;
+    std::shared_ptr<Trace> trace = Trace::open(Helper_functions::getTokenAtIndex(value,1), error);
+    if (!trace){
+        std::cerr<<"["<<c_name <<" (" << pid << ")] PROBLEM IN CAPTURE FLOW: "<<object<<" ("<<error<<")"<<std::endl;
+        return nullptr;
+    }
+    std::string speed_s = Helper_functions::getTokenAtIndex(value,2);
+    char *speed_end;
+    float speed = speed_s.empty() ? 1.0f : std::strtof(speed_s.c_str(), &speed_end);
+    if (speed<0 || (!speed_s.empty() && *speed_end)){
+        std::cerr<<"["<<c_name <<" (" << pid << ")] PROBLEM IN SPEED FLOW: "<<object<<std::endl;
+        return nullptr;
+    }
+    unsigned int options = 0;
+    std::istringstream options_s(Helper_functions::getTokenAtIndex(value,3));
+    std::string option;
+    while (std::getline(options_s, option, '+')){
+        if (option == "loop")
+            options |= Flow::replay_loop;
+        else if (option == "contents")
+            options |= Flow::replay_contents;
+        else if (!option.empty()){
+            std::cerr<<"["<<c_name <<" (" << pid << ")] UNKNOWN OPTION "<<option<<" OF FLOW: "<<object<<std::endl;
+            return nullptr;
+        }
+    }
+    // Template of packets without contents (payloads are at most the snap length)
+    float size = std::min(std::max<size_t>(trace->getSnaplen(), 1), Flow::max_replay_size);
+    auto flow = std::make_shared<Flow>(Flow_type::replay,std::vector<float>{size,0,speed,static_cast<float>(options)},f_name);
+    flow->trace = trace;
+    return flow;
 }
 void ComponentFactory::MQTTbrokerCreator(const std::string& value, 
                                     const std::vector<std::string>& list, 
@@ -420,5 +628,7 @@ void ComponentFactory::MQTTbrokerCreator(const std::string& value,
 }
 std::shared_ptr<Component> ComponentFactory::componentCreator(const std::string& c_name,const std::string& pid) {
     Flow::aflow_number = 1;
+    fsmsCompiler(c_name, pid);
+    portsCompiler(c_name, pid);
     return std::make_shared<Component>(c_name,stoi(pid),std::move(ename_eventsptr),std::move(mname_fsmsptr),std::move(pname_portsptr),std::move(MQTT_broker),std::move(fname_flowsptr));
 }
@@ -1,8 +1,8 @@
 #include "../Objects/Event/event.hpp"
 
-Event::Event(std::string e_name, int timeout):e_name(std::move(e_name)),type(E_type(l)), timeout(timeout) {};
+Event::Event(std::string e_name, int timeout):e_name(std::move(e_name)),type(E_type(l)), timeout(timeout),log_id(Comp_log::intern(this->e_name)),id(0) {};
 
-Event::Event(std::string e_name, E_type type, std::string mqtt_e_name):e_name(std::move(e_name)),type(type),mqtt_e_name(std::move(mqtt_e_name)){}
+Event::Event(std::string e_name, E_type type, std::string mqtt_e_name):e_name(std::move(e_name)),type(type),mqtt_e_name(std::move(mqtt_e_name)),log_id(Comp_log::intern(this->e_name)),id(0){}
 
 std::string &Event::getE_name() { return e_name; }
 std::string &Event::getMqtt_e_name() { return mqtt_e_name; }
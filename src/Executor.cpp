@@ -0,0 +1,85 @@
+#include "../Objects/Executor/executor.hpp"
+#include "../Objects/Simulator/simulator.hpp"
+
+std::mutex Executor::mtx;
+std::condition_variable Executor::cv;
+std::deque<std::function<void()>> Executor::tasks;
+std::vector<std::thread> Executor::threads;
+size_t Executor::idle = 0;
+bool Executor::stopping = false;
+
+/**
+ * @brief Runs a task on a thread of the pool.
+ *
+ * Tasks can block (sockets, waiting on cv), so a new thread is started only if every thread is busy.
+ * In simulation mode the task runs on the simulator thread at the actual virtual time.
+ *
+ * @param task The task.
+ */
+void Executor::submit(std::function<void()> task)
+{
+    if (Simulator::enabled)
+    {
+        Simulator::schedule(Simulator::now(), std::move(task));
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mtx);
+    tasks.push_back(std::move(task));
+    if (tasks.size() > idle)
+        threads.emplace_back(&Executor::work);
+    else
+        cv.notify_one();
+}
+
+/**
+ * @brief Waits until every task (also tasks submitted by running tasks) ends and joins threads.
+ *
+ * Tasks have to end by themselves (terminateFlag).
+ */
+void Executor::stop()
+{
+    while (true)
+    {
+        std::vector<std::thread> joined;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+            if (threads.empty())
+                break;
+            joined.swap(threads);
+        }
+        cv.notify_all();
+        for (auto &thread : joined)
+            thread.join();
+    }
+    std::lock_guard<std::mutex> lock(mtx);
+    stopping = false;
+}
+
+/**
+ * @brief Worker loop, takes tasks until the pool is stopped and the queue is empty.
+ */
+void Executor::work()
+{
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true)
+    {
+        ++idle;
+        cv.wait(lock, [] { return stopping || !tasks.empty(); });
+        --idle;
+        if (tasks.empty())
+            return;
+        std::function<void()> task = std::move(tasks.front());
+        tasks.pop_front();
+        lock.unlock();
+        try
+        {
+            task();
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Task exception: " << e.what() << std::endl;
+        }
+        lock.lock();
+    }
+}
@@ -1,5 +1,9 @@
 #include "../Objects/Flow/flow.hpp"
 short Flow::aflow_number = 1;
+const size_t Flow::header_size;
+const unsigned int Flow::replay_loop;
+const unsigned int Flow::replay_contents;
+const size_t Flow::max_replay_size;
 
 Flow::Flow(Flow_type f_type, std::vector<float> f_parameters2, std::string f_name) : f_type(f_type), f_parameters(f_parameters2)
 {
@@ -7,9 +11,20 @@ Flow::Flow(Flow_type f_type, std::vector<float> f_parameters2, std::string f_nam
         this->f_name = "Anonymous Flow " + std::to_string(aflow_number++);
     else
         this->f_name = f_name;
-    auto full_interval = f_parameters2.at(1);
-    fractionalPart = modff(full_interval, &integralPart) * 100;
+    log_id = Comp_log::intern(this->f_name);
+    interval = std::chrono::nanoseconds(std::llround(static_cast<double>(f_parameters2.at(1)) * 1000000));
+    size_distribution = Size_distribution::size_fixed;
+    size_min = size_mean = f_parameters2.at(0);
+    payload.assign(static_cast<size_t>(std::max(f_parameters2.at(0), 0.0f)), 0);
 };
 std::string &Flow::getF_name() { return f_name; }
 Flow_type &Flow::getF_type() { return f_type; }
-std::vector<float> &Flow::getF_parameters() { return f_parameters; }
\ No newline at end of file
+std::vector<float> &Flow::getF_parameters() { return f_parameters; }
+
+/**
+ * @brief Returns the template of packets of the flow.
+ *
+ * The template is built once and never changed, so packets can be sent from it directly
+ * (also with `MSG_ZEROCOPY`, where the kernel reads it after the send returns).
+ */
+const std::vector<char> &Flow::getPayload() const { return payload; }
\ No newline at end of file
@@ -0,0 +1,312 @@
+#include "../Objects/Component/component.hpp"
+#include "../Objects/Simulator/simulator.hpp"
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+std::mutex Flow_scheduler::mtx;
+std::vector<std::unique_ptr<Client_flow>> Flow_scheduler::flows;
+std::unordered_map<const Fsm *, std::vector<Client_flow *>> Flow_scheduler::fsm_flows;
+std::vector<std::unique_ptr<Flow_scheduler::Pacer>> Flow_scheduler::pacers;
+std::atomic<size_t> Flow_scheduler::next(0);
+std::atomic<bool> Flow_scheduler::stopping(false);
+std::chrono::microseconds Flow_scheduler::batch_window(0);
+size_t Flow_scheduler::zerocopy_min = 0;
+std::chrono::microseconds Flow_scheduler::spin(0);
+bool Flow_scheduler::pin = false;
+unsigned int Flow_scheduler::pacer_count = std::max(1u, std::thread::hardware_concurrency());
+
+/**
+ * @brief Starts sending packets of a client port (its socket is already connected).
+ *
+ * Ports (and the shards of a port) are given to pacing threads in turn, the pacing threads are started with the
+ * first port.
+ *
+ * @param flow The client port.
+ */
+void Flow_scheduler::add(std::unique_ptr<Client_flow> flow)
+{
+    Client_flow *added = flow.get();
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (stopping.load())
+        {
+            flow->component->cleanupSocket(flow->socket, flow->port->getP_name());
+            return;
+        }
+        if (pacers.empty() && !Simulator::enabled)
+            for (unsigned int i = 0; i < pacer_count; ++i)
+            {
+                pacers.push_back(std::unique_ptr<Pacer>(new Pacer()));
+#ifdef USE_IO_URING
+                if (Uring::available())
+                {
+                    std::unique_ptr<Uring> ring(new Uring());
+                    std::string error;
+                    if (ring->init(256, error))
+                        pacers.back()->ring = std::move(ring);
+                    else
+                        std::cerr << "Pacing thread io_uring error (" << error << "), ports use system calls" << std::endl;
+                }
+#endif
+                pacers.back()->thread = std::thread(&Flow_scheduler::run, std::ref(*pacers.back()));
+#ifdef __linux__
+                if (pin)
+                {
+                    cpu_set_t cpus;
+                    CPU_ZERO(&cpus);
+                    CPU_SET(i % std::max(1u, std::thread::hardware_concurrency()), &cpus);
+                    int error = pthread_setaffinity_np(pacers.back()->thread.native_handle(), sizeof(cpus), &cpus);
+                    if (error != 0)
+                        std::cerr << "CANNOT PIN PACING THREAD " << i << ": " << strerror(error) << std::endl;
+                }
+#endif
+            }
+        added->pacer = pacers.empty() ? 0 : next++ % pacers.size();
+#ifdef USE_IO_URING
+        added->ring = pacers.empty() ? nullptr : pacers[added->pacer]->ring.get();
+#endif
+        added->gen.store(0);
+        added->closed = false;
+        added->stats = Flow_stats();
+        fsm_flows[added->fsm.get()].push_back(added);
+        flows.push_back(std::move(flow));
+    }
+    push(Entry{Simulator::steadyNow(), added, 0, true});
+}
+
+/**
+ * @brief Applies a state change of an FSM to the ports it controls.
+ *
+ * The ports check the flow of the new state at once and wait a full interval before the next packet.
+ *
+ * @param fsm The FSM which changed state.
+ */
+void Flow_scheduler::fsmChanged(const Fsm *fsm)
+{
+    std::vector<Entry> entries;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = fsm_flows.find(fsm);
+        if (it == fsm_flows.end())
+            return;
+        auto now = Simulator::steadyNow();
+        for (auto flow : it->second)
+            entries.push_back(Entry{now, flow, ++flow->gen, true});
+    }
+    for (auto &entry : entries)
+        push(entry);
+}
+
+void Flow_scheduler::push(const Entry &entry)
+{
+    if (Simulator::enabled)
+    {
+        Simulator::schedule(std::chrono::duration_cast<std::chrono::nanoseconds>(entry.deadline.time_since_epoch()).count(), [entry]() {
+            Entry next;
+            if (!stopping.load() && fire(entry, next))
+                push(next);
+        });
+        return;
+    }
+    Pacer &pacer = *pacers[entry.flow->pacer];
+    bool earliest;
+    {
+        std::lock_guard<std::mutex> lock(pacer.mtx);
+        earliest = pacer.heap.empty() || entry.deadline < pacer.heap.top().deadline;
+        pacer.heap.push(entry);
+    }
+    if (earliest)
+        pacer.cv.notify_one();
+}
+
+/**
+ * @brief Stops the pacing threads and closes the sockets of client ports.
+ */
+void Flow_scheduler::stop()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    stopping.store(true);
+    for (auto &pacer : pacers)
+    {
+        {
+            std::lock_guard<std::mutex> pacerLock(pacer->mtx); // the pacer waits or sees stopping
+        }
+        pacer->cv.notify_one();
+    }
+    for (auto &pacer : pacers)
+        pacer->thread.join();
+    // Shards of a port are reported together
+    std::vector<std::pair<Client_flow *, Flow_stats>> ports;
+    std::unordered_map<const Port *, size_t> port_index;
+    for (auto &flow : flows)
+    {
+        auto it = port_index.find(flow->port.get());
+        if (it == port_index.end())
+        {
+            port_index[flow->port.get()] = ports.size();
+            ports.push_back({flow.get(), flow->stats});
+        }
+        else
+            ports[it->second].second.merge(flow->stats);
+        if (!flow->closed)
+            flow->component->cleanupSocket(flow->socket, flow->port->getP_name());
+    }
+    for (auto &port : ports)
+        port.first->component->printFlowStats(*port.first, port.second);
+}
+
+/**
+ * @brief Pacing thread loop, sends packets of ports whose deadline is reached.
+ *
+ * The thread waits until the absolute deadline (the condition variable waits on the steady clock, so new earlier
+ * deadlines wake it up). With `spin` the last part of the wait is busy waiting, for intervals shorter than
+ * the wake up latency of the system.
+ */
+void Flow_scheduler::run(Pacer &pacer)
+{
+    #ifdef _WIN32
+        timeBeginPeriod(1);
+    #elif defined(__linux__)
+        prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0); // wake up at the deadline, not up to 50 us later
+    #endif
+    std::vector<Entry> due, rescheduled; // reused, so the loop doesn't allocate
+    std::unique_lock<std::mutex> lock(pacer.mtx);
+    while (!stopping.load())
+    {
+        if (pacer.heap.empty())
+        {
+            pacer.cv.wait(lock);
+            continue;
+        }
+        auto now = std::chrono::steady_clock::now();
+        auto deadline = pacer.heap.top().deadline;
+        if (deadline - now > spin)
+        {
+            pacer.cv.wait_until(lock, deadline - spin);
+            continue;
+        }
+        if (deadline > now)
+        {
+            lock.unlock();
+            while (std::chrono::steady_clock::now() < deadline && !stopping.load())
+                ;
+            lock.lock();
+            continue; // an earlier deadline could be pushed meanwhile
+        }
+        while (!pacer.heap.empty() && pacer.heap.top().deadline <= now)
+        {
+            due.push_back(pacer.heap.top());
+            pacer.heap.pop();
+        }
+        lock.unlock();
+        for (auto &entry : due)
+        {
+            Entry next;
+            if (fire(entry, next))
+                rescheduled.push_back(next);
+        }
+        due.clear();
+#ifdef USE_IO_URING
+        flush(pacer);
+#endif
+        lock.lock();
+        // Next deadlines of sent ports are pushed under one lock (the pacer computes the next wait itself)
+        for (auto &entry : rescheduled)
+            pacer.heap.push(entry);
+        rescheduled.clear();
+    }
+    #ifdef _WIN32
+        timeEndPeriod(1);
+    #endif
+}
+
+/**
+ * @brief Handles a reached deadline of a port: sends the packet and prepares the next one.
+ *
+ * A UDP port sends more packets at once: packets which were due while the pacer was late and packets due within
+ * `batch_window` of the deadline. The next deadline is the deadline moved by the times between sent packets,
+ * so a late port catches up. A port (or shard) which is more than `max_batch` of its sends late skips
+ * the missed packets.
+ *
+ * @param entry The deadline.
+ * @param next The next deadline of the port.
+ * @return false if the deadline is stale or the port was closed (no next deadline).
+ */
+bool Flow_scheduler::fire(const Entry &entry, Entry &next)
+{
+    Client_flow &flow = *entry.flow;
+    if (flow.closed || entry.gen != flow.gen.load())
+        return false; // the FSM changed state after this deadline was set
+    auto now = Simulator::steadyNow();
+    if (!entry.reconfigure)
+    {
+        long long lateness = std::chrono::duration_cast<std::chrono::nanoseconds>(now - entry.deadline).count();
+        ++flow.stats.late_count;
+        flow.stats.late_total += lateness;
+        flow.stats.late_max = std::max(flow.stats.late_max, lateness);
+    }
+    next = Entry{entry.deadline, &flow, entry.gen, false};
+    bool open;
+    if (entry.reconfigure)
+    {
+        open = flow.component->prepareFlow(flow);
+        next.deadline += flow.interval;
+    }
+    else
+    {
+        // UDP sends late packets and packets of the window together
+        auto horizon = std::max(now + std::chrono::nanoseconds(1), entry.deadline + batch_window);
+        open = flow.component->sendPackets(flow, next.deadline, horizon, flow.listenFlag ? 1 : max_batch);
+    }
+    if (!open)
+    {
+#ifdef USE_IO_URING
+        if (flow.ring)
+            flush(*pacers[flow.pacer]); // queued packets are sent before the socket is closed
+#endif
+        flow.closed = true;
+        flow.component->cleanupSocket(flow.socket, flow.port->getP_name());
+        return false;
+    }
+    // A shard sends every `shards`-th packet of the flow, whole steps keep it in its slot of the schedule
+    auto step = flow.actualFlow->interval * static_cast<long long>(flow.shards);
+    if (step.count() > 0 && now - next.deadline > step * static_cast<long long>(max_batch))
+    {
+        long long behind = (now - next.deadline) / step;
+        flow.stats.skipped += behind; // packets of this shard, summed over the shards by merge
+        next.deadline += step * behind;
+    }
+    return true;
+}
+
+#ifdef USE_IO_URING
+/**
+ * @brief Sends packets queued in the ring of a pacing thread and waits until they are sent.
+ *
+ * Headers of queued packets are in the batches of their ports, so every send has to complete before
+ * the port is fired again.
+ */
+void Flow_scheduler::flush(Pacer &pacer)
+{
+    if (!pacer.ring)
+        return;
+    Uring &ring = *pacer.ring;
+    while (ring.inflight)
+    {
+        int result = ring.submit(1);
+        if (result < 0)
+        {
+            std::cerr << "Pacing thread io_uring error: " << strerror(-result) << std::endl;
+            return;
+        }
+        io_uring_cqe cqe;
+        while (ring.completion(cqe))
+        {
+            --ring.inflight;
+            Client_flow &flow = *reinterpret_cast<Client_flow *>(cqe.user_data);
+            flow.component->packetsSent(flow, cqe.res);
+        }
+    }
+}
+#endif
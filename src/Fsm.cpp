@@ -1,23 +1,71 @@
 #include "../Objects/FSM/fsm.hpp"
 #include "../Headers/helper_functions.hpp"
 
-Fsm::Fsm(std::string m_name, std::unordered_map<std::string, std::shared_ptr<State>> sname_statesptr, std::string initial):m_name(std::move(m_name)),sname_statesptr(std::move(sname_statesptr)),changeRequested(false), s_name(std::move(initial)){}
+Fsm::Fsm(std::string m_name, std::unordered_map<std::string, std::shared_ptr<State>> sname_statesptr, std::string initial):m_name(std::move(m_name)),sname_statesptr(std::move(sname_statesptr)),initial(std::move(initial)),s_id(0),epoch(0),event_count(0),log_id(Comp_log::intern(this->m_name)){}
 
 std::string &Fsm::getM_name() { return m_name; }
-std::string Fsm::getS_name() {         
-    std::lock_guard<std::mutex> lock(mtx);
-    return s_name; 
-    }
-void Fsm::setS_name(std::string s_name)
+std::string &Fsm::getInitial() { return initial; }
+std::unordered_map<std::string, std::shared_ptr<State>> &Fsm::getStates() { return sname_statesptr; }
+
+/**
+ * @brief Sets the compiled FSM (called once by ComponentFactory before the emulation starts).
+ *
+ * @param states States by id.
+ * @param compiled_states Resolved on-entry and on-exit actions by state id.
+ * @param table Transitions, state id * event_count + event id.
+ * @param event_count Number of events of the component.
+ * @param initial_id Id of the initial state.
+ */
+void Fsm::setTable(std::vector<std::shared_ptr<State>> states, std::vector<Compiled_state> compiled_states,
+                   std::vector<Compiled_transition> table, size_t event_count, unsigned int initial_id)
 {
-    {
-        std::lock_guard<std::mutex> lock(mtx);
-        this->s_name = s_name;
-    }
-    
-    changeRequested.store(true);
+    this->states = std::move(states);
+    this->compiled_states = std::move(compiled_states);
+    this->table = std::move(table);
+    this->event_count = event_count;
+    s_id.store(initial_id);
 }
 
- std::shared_ptr<State> Fsm::getState(const std::string& s_name){
-    return Helper_functions::getObjectByName(sname_statesptr, s_name);
+/**
+ * @brief Returns the current state id (lock-free, readers compare `getEpoch` to see a change without reading the state).
+ */
+unsigned int Fsm::getS_id() { return s_id.load(std::memory_order_acquire); }
+unsigned long long Fsm::getEpoch() { return epoch.load(std::memory_order_acquire); }
+/**
+ * @brief Changes the current state (only the task of the component processing events writes it).
+ *
+ * The epoch is incremented after the state id is stored, so a reader which sees the new epoch also sees the new state.
+ */
+void Fsm::setS_id(unsigned int s_id)
+{
+    this->s_id.store(s_id, std::memory_order_release);
+    epoch.fetch_add(1, std::memory_order_acq_rel);
+}
+size_t Fsm::getState_count() { return states.size(); }
+
+State &Fsm::getState(unsigned int s_id) { return *states[s_id]; }
+const Fsm::Compiled_state &Fsm::getCompiled_state(unsigned int s_id) { return compiled_states[s_id]; }
+const Fsm::Compiled_transition &Fsm::getTransition(unsigned int s_id, unsigned int e_id) { return table[s_id * event_count + e_id]; }
+
+/**
+ * @brief Checks if any state of the FSM has a transition on the event.
+ */
+bool Fsm::hasTransition(unsigned int e_id) {
+    for (size_t s_id = 0; s_id < states.size(); ++s_id)
+        if (table[s_id * event_count + e_id].target != no_transition)
+            return true;
+    return false;
+}
+/**
+ * @brief Returns every event used as an action of the FSM (on-entry, on-exit and transition actions).
+ */
+std::unordered_set<Event *> Fsm::getActions() {
+    std::unordered_set<Event *> actions;
+    for (auto &state : compiled_states) {
+        actions.insert(state.on_entry.begin(), state.on_entry.end());
+        actions.insert(state.on_exit.begin(), state.on_exit.end());
+    }
+    for (auto &transition : table)
+        actions.insert(transition.actions.begin(), transition.actions.end());
+    return actions;
 }
@@ -0,0 +1,214 @@
+#include "../Objects/Comp_log/log_writer.hpp"
+
+std::mutex Log_buffer::registry_mtx;
+std::vector<std::shared_ptr<Log_buffer>> Log_buffer::registry;
+std::vector<std::shared_ptr<Log_buffer>> Log_buffer::free_buffers;
+std::mutex Log_buffer::pool_mtx;
+std::condition_variable Log_buffer::pool_cv;
+std::vector<Log_buffer::Chunk *> Log_buffer::chunk_pool;
+std::atomic<size_t> Log_buffer::chunks(0);
+std::atomic<size_t> Log_buffer::max_chunks(static_cast<size_t>(-1));
+std::atomic<bool> Log_buffer::starved(false);
+std::atomic<unsigned long long> Log_buffer::dropped(0);
+std::atomic<long long> Log_buffer::first_drop(0);
+std::atomic<long long> Log_buffer::last_drop(0);
+
+namespace
+{
+    // Returns the thread's buffer to the free list when the thread ends (buffer keeps its unread logs).
+    struct Log_buffer_owner
+    {
+        std::shared_ptr<Log_buffer> buffer;
+        ~Log_buffer_owner() { Log_buffer::release(buffer); }
+    };
+}
+
+Log_buffer::Log_buffer() : head(allocChunk(true)), tail(head), read_pos(0) {}
+
+Log_buffer::~Log_buffer()
+{
+    while (head)
+    {
+        Chunk *next = head->next.load(std::memory_order_relaxed);
+        delete head;
+        head = next;
+    }
+}
+
+/**
+ * @brief Takes a chunk from the pool or allocates a new one.
+ *
+ * @param force Allocate even when the memory limit is reached (first chunk of a buffer).
+ * @return The chunk, or nullptr when the memory limit is reached.
+ */
+Log_buffer::Chunk *Log_buffer::allocChunk(bool force)
+{
+    {
+        std::lock_guard<std::mutex> lock(pool_mtx);
+        if (!chunk_pool.empty())
+        {
+            Chunk *chunk = chunk_pool.back();
+            chunk_pool.pop_back();
+            chunk->count.store(0, std::memory_order_relaxed);
+            chunk->next.store(nullptr, std::memory_order_relaxed);
+            return chunk;
+        }
+    }
+    if (!force && chunks.load() >= max_chunks.load())
+        return nullptr;
+    ++chunks;
+    return new Chunk();
+}
+
+void Log_buffer::freeChunk(Chunk *chunk)
+{
+    {
+        std::lock_guard<std::mutex> lock(pool_mtx);
+        chunk_pool.push_back(chunk);
+    }
+    starved.store(false);
+    pool_cv.notify_all();
+}
+
+/**
+ * @brief Wakes the writer and waits until it gives a chunk back (the memory limit is reached).
+ *
+ * The writer frees chunks while it drains the buffers, so the wait is usually as short as one drain.
+ * It is limited by the flush interval and skipped when the writer doesn't run or didn't free a chunk
+ * for the previous wait (only chunks still written by their threads are left), then the writer isn't woken
+ * either and drops are written once per flush interval.
+ *
+ * @return The chunk, or nullptr when no chunk was freed in time.
+ */
+Log_buffer::Chunk *Log_buffer::waitChunk()
+{
+    if (starved.load() || !Log_writer::wake())
+        return nullptr;
+    std::unique_lock<std::mutex> lock(pool_mtx);
+    if (!pool_cv.wait_for(lock, Log_writer::flush_interval, [] { return !chunk_pool.empty(); }))
+    {
+        starved.store(true);
+        return nullptr;
+    }
+    Chunk *chunk = chunk_pool.back();
+    chunk_pool.pop_back();
+    chunk->count.store(0, std::memory_order_relaxed);
+    chunk->next.store(nullptr, std::memory_order_relaxed);
+    return chunk;
+}
+
+/**
+ * @brief Limits the memory of logs waiting for the writer.
+ *
+ * @param bytes Maximum size of all chunks (at least one chunk per thread is always allocated).
+ */
+void Log_buffer::setMemoryLimit(size_t bytes)
+{
+    max_chunks.store(std::max<size_t>(bytes / sizeof(Chunk), 1));
+}
+
+/**
+ * @brief Appends a log to the buffer (owner thread only).
+ *
+ * The record is written into the current chunk and published by the release store of `count`,
+ * so the writer thread never sees a partially written record. A full chunk is linked to a new one,
+ * if the memory limit is reached the thread waits for the writer to give a chunk back
+ * and the log is dropped only when the writer doesn't free one in time.
+ *
+ * @param log The log to append.
+ */
+void Log_buffer::push(Comp_log &&log)
+{
+    Chunk *chunk = tail;
+    size_t n = chunk->count.load(std::memory_order_relaxed);
+    if (n == CHUNK_SIZE)
+    {
+        Chunk *next = allocChunk();
+        if (!next)
+            next = waitChunk();
+        if (!next)
+        {
+            // The writer writes the count and time of dropped logs into the output, so the gap is visible
+            long long zero = 0;
+            first_drop.compare_exchange_strong(zero, log.ts);
+            last_drop.store(log.ts);
+            ++dropped;
+            return;
+        }
+        chunk->next.store(next, std::memory_order_release);
+        tail = chunk = next;
+        n = 0;
+    }
+    chunk->records[n] = std::move(log);
+    chunk->count.store(n + 1, std::memory_order_release);
+}
+
+/**
+ * @brief Moves every published log out of the buffer (single consumer only).
+ *
+ * Fully read chunks go back to the pool, the chunk still used by the owner thread is kept.
+ *
+ * @param out Vector the logs are appended to.
+ */
+void Log_buffer::drain(std::vector<Comp_log> &out)
+{
+    while (true)
+    {
+        size_t n = head->count.load(std::memory_order_acquire);
+        for (; read_pos < n; ++read_pos)
+            out.push_back(std::move(head->records[read_pos]));
+        if (read_pos < CHUNK_SIZE)
+            return;
+        Chunk *next = head->next.load(std::memory_order_acquire);
+        if (!next)
+            return;
+        freeChunk(head);
+        head = next;
+        read_pos = 0;
+    }
+}
+
+/**
+ * @brief Returns the buffer of the calling thread.
+ *
+ * The registry mutex is taken only the first time a thread logs, buffers of finished threads are reused.
+ */
+Log_buffer &Log_buffer::local()
+{
+    static thread_local Log_buffer_owner owner;
+    if (!owner.buffer)
+    {
+        std::lock_guard<std::mutex> lock(registry_mtx);
+        if (free_buffers.empty())
+        {
+            owner.buffer = std::make_shared<Log_buffer>();
+            registry.push_back(owner.buffer);
+        }
+        else
+        {
+            owner.buffer = std::move(free_buffers.back());
+            free_buffers.pop_back();
+        }
+    }
+    return *owner.buffer;
+}
+
+void Log_buffer::release(std::shared_ptr<Log_buffer> &buffer)
+{
+    if (!buffer)
+        return;
+    std::lock_guard<std::mutex> lock(registry_mtx);
+    free_buffers.push_back(std::move(buffer));
+}
+
+/**
+ * @brief Drains the buffers of every thread.
+ *
+ * @param out Vector the logs are appended to (in buffer order, not merged).
+ */
+void Log_buffer::drainAll(std::vector<Comp_log> &out)
+{
+    std::lock_guard<std::mutex> lock(registry_mtx);
+    for (auto &buffer : registry)
+        buffer->drain(out);
+}
@@ -0,0 +1,354 @@
+#include "../Objects/Comp_log/log_writer.hpp"
+
+std::thread Log_writer::writer;
+std::mutex Log_writer::mtx;
+std::condition_variable Log_writer::cv;
+bool Log_writer::stopRequested = false;
+bool Log_writer::wakeRequested = false;
+std::ofstream Log_writer::outputFile;
+long long Log_writer::cached_second = -1;
+std::string Log_writer::cached_time;
+unsigned long long Log_writer::written_drops = 0;
+std::chrono::milliseconds Log_writer::flush_interval(100);
+Time_format Log_writer::time_format = Time_format::hms;
+std::ofstream Log_writer::traceFile;
+bool Log_writer::traceEmpty = true;
+std::map<std::tuple<unsigned int, Log_writer::Track_kind, unsigned int>, unsigned int> Log_writer::tracks;
+std::string Log_writer::trace_path;
+
+/**
+ * @brief Opens the output file and starts the writer thread.
+ *
+ * If `trace_path` is set, a Chrome JSON trace is written too.
+ *
+ * @param path Path of the output file (truncated, then only appended).
+ * @param max_memory Maximum memory (bytes) of logs waiting in the thread buffers.
+ * @return false if the output file or the trace can't be opened.
+ */
+bool Log_writer::start(const std::string &path, size_t max_memory)
+{
+    Log_buffer::setMemoryLimit(max_memory);
+    outputFile.open(path, std::ios::out | std::ios::trunc);
+    if (!outputFile.is_open())
+    {
+        std::cerr << "Unable to open file!" << std::endl;
+        return false;
+    }
+    if (!trace_path.empty())
+    {
+        traceFile.open(trace_path, std::ios::out | std::ios::trunc);
+        if (!traceFile.is_open())
+        {
+            std::cerr << "Unable to open trace file " << trace_path << std::endl;
+            outputFile.close();
+            return false;
+        }
+        traceEmpty = true;
+        traceFile << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    }
+    if (!Comp_log::filter_description.empty()) // Sampled files are marked, so analysis of them can take it into account
+        outputFile << "name: log_filter\nts: \npid: 0\ncat: meta \nargs: " << Comp_log::filter_description << " \nend: \n\n";
+    stopRequested = false;
+    writer = std::thread(&Log_writer::run);
+    return true;
+}
+
+/**
+ * @brief Wakes the writer before its flush interval (used when the memory limit is reached).
+ *
+ * @return false if the writer is stopping, so no more chunks are freed.
+ */
+bool Log_writer::wake()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (stopRequested)
+            return false;
+        wakeRequested = true;
+    }
+    cv.notify_one();
+    return true;
+}
+
+/**
+ * @brief Writes the last logs and closes the output file.
+ *
+ * Begin-end logs which are still open get the current time as end time.
+ */
+void Log_writer::stop()
+{
+    if (!writer.joinable())
+        return;
+    Comp_log::closeSpans();
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopRequested = true;
+    }
+    cv.notify_one();
+    writer.join();
+    outputFile.close();
+    if (traceFile.is_open())
+    {
+        traceFile << "\n]";
+        if (!Comp_log::filter_description.empty() || written_drops)
+        {
+            traceFile << ",\"metadata\":{";
+            if (!Comp_log::filter_description.empty())
+            {
+                traceFile << "\"log-filter\":";
+                writeJsonString(Comp_log::filter_description);
+            }
+            if (written_drops)
+                traceFile << (Comp_log::filter_description.empty() ? "" : ",") << "\"dropped-logs\":" << written_drops;
+            traceFile << "}";
+        }
+        traceFile << "}\n";
+        traceFile.close();
+    }
+    if (Log_buffer::dropped.load())
+        std::cerr << "Log memory limit reached, " << Log_buffer::dropped.load() << " logs dropped" << std::endl;
+}
+
+/**
+ * @brief Writer thread loop.
+ *
+ * Every flush interval the buffers of all threads are drained and written to the output file,
+ * so the memory of logs doesn't grow during the emulation. The stop request is read before the last drain,
+ * so every log created before `stop` is written.
+ */
+void Log_writer::run()
+{
+    std::vector<Comp_log> batch;
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true)
+    {
+        bool stopping = stopRequested;
+        wakeRequested = false;
+        lock.unlock();
+        Log_buffer::drainAll(batch);
+        writeBatch(batch);
+        writeDrops();
+        lock.lock();
+        if (stopping)
+            return;
+        cv.wait_for(lock, flush_interval, [] { return stopRequested || wakeRequested; });
+    }
+}
+
+/**
+ * @brief Writes drained logs ordered by creation time.
+ *
+ * Begin-end logs are written when they end, so they can be placed after later instant logs.
+ * Metadata logs are written only to the trace.
+ *
+ * @param batch Drained logs (cleared after writing).
+ */
+void Log_writer::writeBatch(std::vector<Comp_log> &batch)
+{
+    std::stable_sort(batch.begin(), batch.end(), [](const Comp_log &a, const Comp_log &b) { return a.ts < b.ts; });
+    for (auto &a : batch)
+    {
+        if (traceFile.is_open())
+            writeTrace(a);
+        if (a.ph_value == ph_type::M)
+            continue;
+        outputFile << "name: " << Comp_log::getText(a.name) << '\n';
+        outputFile << "ts: ";
+        writeTime(a.ts);
+        outputFile << '\n';
+        outputFile << "pid: " << a.pid << '\n';
+
+        outputFile << "cat: " << Comp_log::getCat(a.cat) << '\n';
+
+        outputFile << "args: ";
+        for (unsigned int i = 0; i < a.argc; ++i)
+            outputFile << a.getArg(i) << " ";
+        outputFile << '\n';
+
+        outputFile << "end: ";
+        if (a.end)
+            writeTime(a.end);
+        outputFile << '\n';
+        outputFile << '\n';
+    }
+    outputFile.flush();
+    if (traceFile.is_open())
+        traceFile.flush();
+    batch.clear();
+}
+
+/**
+ * @brief Marks logs dropped since the last mark (memory limit reached) in the output file.
+ *
+ * The mark is a metadata log `dropped_logs` with the number of dropped logs and times of the first
+ * and the last of them, so the gap in the logs can be found by the analysis.
+ */
+void Log_writer::writeDrops()
+{
+    unsigned long long dropped = Log_buffer::dropped.load();
+    if (dropped == written_drops)
+        return;
+    long long first = Log_buffer::first_drop.exchange(0), last = Log_buffer::last_drop.load();
+    outputFile << "name: dropped_logs\nts: ";
+    writeTime(first ? first : last);
+    outputFile << "\npid: 0\ncat: meta \nargs: " << dropped - written_drops << " \nend: ";
+    writeTime(std::max(first, last));
+    outputFile << "\n\n";
+    outputFile.flush();
+    written_drops = dropped;
+}
+
+/**
+ * @brief Writes a raw tick in the selected time format.
+ *
+ * `hms` - local time HH:MM:SS:microseconds (the part up to seconds is formatted once per second),
+ * 
+ * `epoch_ns` - nanoseconds since the epoch (keeps the date, so runs across midnight can be analysed).
+ *
+ * @param tick Raw steady clock tick of the log.
+ */
+void Log_writer::writeTime(const long long &tick)
+{
+    long long ns = Comp_log::getEpochNs(tick);
+    if (time_format == Time_format::epoch_ns)
+    {
+        outputFile << ns;
+        return;
+    }
+    long long second = ns / 1000000000;
+    if (second != cached_second)
+    {
+        cached_second = second;
+        cached_time = Comp_log::getFormattedTime(ns).substr(0, 8);
+    }
+    char micro[16];
+    snprintf(micro, sizeof(micro), ":%06lld", (ns / 1000) % 1000000);
+    outputFile << cached_time << micro;
+}
+
+/**
+ * @brief Writes a log as an event of the Chrome JSON trace.
+ *
+ * Components are processes. States are complete ("X") events on the track of their FSM, flows on the track
+ * of flows of the FSM which controls them, packets are instant events on the track of their port
+ * and events of a component share one track. Arguments keep their position as keys.
+ *
+ * @param a The log.
+ */
+void Log_writer::writeTrace(const Comp_log &a)
+{
+    traceFile << (traceEmpty ? "\n" : ",\n");
+    traceEmpty = false;
+    if (a.ph_value == ph_type::M)
+    {
+        traceFile << "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":" << a.pid << ",\"tid\":0,\"args\":{\"name\":";
+        writeJsonString(Comp_log::getText(a.name));
+        traceFile << "}}";
+        return;
+    }
+    unsigned int tid = getTrack(a);
+    std::string cat = Comp_log::getCat(a.cat);
+    cat.pop_back();
+    std::replace(cat.begin(), cat.end(), ' ', ',');
+
+    traceFile << "{\"ph\":" << (a.ph_value == ph_type::BE ? "\"X\"" : "\"i\",\"s\":\"t\"") << ",\"name\":";
+    if (a.cat == Comp_log::cat_state && a.argc > 0)
+        writeJsonString(a.getArg(0)); // state
+    else if (a.cat == Comp_log::cat_packet_snd || a.cat == Comp_log::cat_packet_rcv)
+        writeJsonString(cat.substr(cat.rfind(',') + 1)); // packet_snd or packet_rcv
+    else
+        writeJsonString(Comp_log::getText(a.name));
+    traceFile << ",\"cat\":";
+    writeJsonString(cat);
+    traceFile << ",\"ts\":";
+    writeTraceTime(a.ts - Comp_log::tick_anchor);
+    if (a.ph_value == ph_type::BE)
+    {
+        traceFile << ",\"dur\":";
+        writeTraceTime(a.end - a.ts);
+    }
+    traceFile << ",\"pid\":" << a.pid << ",\"tid\":" << tid << ",\"args\":{";
+    for (unsigned int i = 0; i < a.argc; ++i)
+    {
+        traceFile << (i ? ",\"" : "\"") << i << "\":";
+        if (a.arg_types[i] == Comp_log::arg_text)
+            writeJsonString(a.getArg(i));
+        else
+            traceFile << a.getArg(i);
+    }
+    traceFile << "}}";
+}
+
+/**
+ * @brief Returns the track (tid) of a log, the track is named by a metadata event when it is used first time.
+ */
+unsigned int Log_writer::getTrack(const Comp_log &a)
+{
+    std::tuple<unsigned int, Track_kind, unsigned int> key;
+    std::string name;
+    if (a.cat == Comp_log::cat_state)
+    {
+        key = std::make_tuple(a.pid, track_fsm, a.name);
+        name = Comp_log::getText(a.name);
+    }
+    else if (a.cat == Comp_log::cat_flow && a.argc > 1 && a.arg_types[1] == Comp_log::arg_text)
+    {
+        key = std::make_tuple(a.pid, track_flows, static_cast<unsigned int>(a.arg_values[1]));
+        name = Comp_log::getText(static_cast<unsigned int>(a.arg_values[1])) + " flows";
+    }
+    else if (a.cat == Comp_log::cat_packet_snd || a.cat == Comp_log::cat_packet_rcv)
+    {
+        key = std::make_tuple(a.pid, track_port, a.name);
+        name = Comp_log::getText(a.name);
+        if (a.argc > 0)
+            name += "(" + a.getArg(0) + ")";
+    }
+    else
+    {
+        key = std::make_tuple(a.pid, track_events, 0u);
+        name = "events";
+    }
+    auto it = tracks.find(key);
+    if (it != tracks.end())
+        return it->second;
+
+    unsigned int tid = 1;
+    for (const auto &track : tracks)
+        if (std::get<0>(track.first) == a.pid)
+            ++tid;
+    tracks[key] = tid;
+    traceFile << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << a.pid << ",\"tid\":" << tid << ",\"args\":{\"name\":";
+    writeJsonString(name);
+    traceFile << "}},\n{\"ph\":\"M\",\"name\":\"thread_sort_index\",\"pid\":" << a.pid << ",\"tid\":" << tid
+              << ",\"args\":{\"sort_index\":" << static_cast<int>(std::get<1>(key)) * 1000 + tid << "}},\n";
+    return tid;
+}
+
+/**
+ * @brief Writes a duration of ticks in microseconds (unit of the Chrome trace) with nanosecond precision.
+ */
+void Log_writer::writeTraceTime(const long long &ticks)
+{
+    char time[32];
+    snprintf(time, sizeof(time), "%lld.%03lld", ticks / 1000, ticks % 1000);
+    traceFile << time;
+}
+
+void Log_writer::writeJsonString(const std::string &value)
+{
+    traceFile << '"';
+    for (char c : value)
+    {
+        if (c == '"' || c == '\\')
+            traceFile << '\\' << c;
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            traceFile << escaped;
+        }
+        else
+            traceFile << c;
+    }
+    traceFile << '"';
+}
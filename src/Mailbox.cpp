@@ -0,0 +1,87 @@
+#include "../Objects/Mailbox/mailbox.hpp"
+
+Mailbox::Mailbox() : head(&stub), tail(&stub), depth(0), max_depth(0), processed(0), total_latency(0), max_latency(0)
+{
+    stub.next.store(nullptr);
+}
+
+Mailbox::~Mailbox()
+{
+    long long enqueued;
+    while (pop(enqueued))
+        ;
+}
+
+void Mailbox::pushNode(Node *node)
+{
+    node->next.store(nullptr, std::memory_order_relaxed);
+    Node *prev = head.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+}
+
+/**
+ * @brief Appends an event (any thread).
+ *
+ * @return true if the mailbox was empty, then the caller has to schedule the consumer.
+ */
+bool Mailbox::push(std::shared_ptr<Event> event)
+{
+    Node *node = new Node();
+    node->event = std::move(event);
+    node->enqueued = Comp_log::getTick();
+    pushNode(node);
+    size_t previous = depth.fetch_add(1);
+    size_t max = max_depth.load();
+    while (previous + 1 > max && !max_depth.compare_exchange_weak(max, previous + 1))
+        ;
+    return previous == 0;
+}
+
+/**
+ * @brief Takes the oldest event (consumer only).
+ *
+ * @param enqueued Set to the tick when the event was pushed.
+ * @return The event, or nullptr if the mailbox is empty or a producer hasn't linked its node yet.
+ */
+std::shared_ptr<Event> Mailbox::pop(long long &enqueued)
+{
+    Node *first = tail;
+    Node *next = first->next.load(std::memory_order_acquire);
+    if (first == &stub)
+    {
+        if (!next)
+            return nullptr;
+        tail = first = next;
+        next = next->next.load(std::memory_order_acquire);
+    }
+    if (!next)
+    {
+        if (first != head.load(std::memory_order_acquire))
+            return nullptr; // a producer is between exchange and link
+        pushNode(&stub);
+        next = first->next.load(std::memory_order_acquire);
+        if (!next)
+            return nullptr;
+    }
+    tail = next;
+    std::shared_ptr<Event> event = std::move(first->event);
+    enqueued = first->enqueued;
+    delete first;
+    return event;
+}
+
+/**
+ * @brief Counts a processed event (consumer only).
+ *
+ * @param enqueued Tick when the event was pushed.
+ * @return true if more events are waiting (the consumer has to continue).
+ */
+bool Mailbox::processedOne(const long long &enqueued)
+{
+    unsigned long long latency = Comp_log::getTick() - enqueued;
+    ++processed;
+    total_latency += latency;
+    if (latency > max_latency.load())
+        max_latency.store(latency);
+    return depth.fetch_sub(1) > 1;
+}
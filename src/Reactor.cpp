@@ -0,0 +1,379 @@
+#include "../Objects/Reactor/reactor.hpp"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+std::once_flag Reactor::reactors_flag;
+std::vector<std::unique_ptr<Reactor>> Reactor::reactors;
+std::atomic<unsigned int> Reactor::next(0);
+std::atomic<bool> Reactor::stopping(false);
+bool Reactor::reuseport = false;
+const size_t Reactor::buffer_size;
+#ifdef USE_IO_URING
+std::atomic<unsigned int> Reactor::next_id(1); // 0 is the wake up read
+#endif
+
+Reactor::Reactor() : epoll_fd(epoll_create1(EPOLL_CLOEXEC)), wake_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+#ifdef USE_IO_URING
+    , multishot(true)
+#endif
+{
+#ifdef USE_IO_URING
+    if (Uring::available())
+    {
+        ring.reset(new Uring());
+        std::string error;
+        if (!ring->init(256, error) || !ring->provideBuffers(512, buffer_size, error))
+        {
+            std::cerr << "Reactor io_uring error (" << error << "), the reactor uses epoll" << std::endl;
+            ring.reset();
+        }
+    }
+#endif
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = wake_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &event);
+    thread = std::thread(&Reactor::run, this);
+}
+
+Reactor::~Reactor()
+{
+    close(wake_fd);
+    close(epoll_fd);
+}
+
+/**
+ * @brief Returns the number of reactors (started at the first call, one per core, none after stop).
+ *
+ * The reactors live until the end of the program (stop only ends their threads), so the list is never changed
+ * after it was created and handlers can add sockets without a lock.
+ */
+size_t Reactor::count()
+{
+    std::call_once(reactors_flag, []() {
+        unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned int i = 0; i < cores; ++i)
+            reactors.push_back(std::unique_ptr<Reactor>(new Reactor()));
+    });
+    return reactors.size();
+}
+
+/**
+ * @brief Gives a socket which receives data to a reactor.
+ *
+ * With epoll the socket is watched level-triggered, one message is read when it is readable (the handler is called
+ * again if more data is waiting). With io_uring data is received into buffers of the reactor by a multishot receive.
+ *
+ * @param fd The socket.
+ * @param on_data Called with received data (`buffer_size` at most), 0 if the peer closed the connection or < 0 on error,
+ * returns false if it closed the socket.
+ * @param on_close Called when the reactors stop or an error is reported on the socket.
+ * @param reactor Index of the reactor (modulo count), by default reactors are used in turn.
+ */
+void Reactor::receive(int fd, std::function<bool(const char *, int)> on_data, std::function<void()> on_close, size_t reactor)
+{
+    auto handler = std::make_shared<Handler>();
+    handler->on_data = std::move(on_data);
+    handler->on_close = std::move(on_close);
+    const Handler *owner = handler.get();
+    handler->on_readable = [fd, owner]() {
+        static thread_local std::vector<char> buffer(buffer_size); // reused by every call on the thread
+        ssize_t received = recv(fd, buffer.data(), buffer.size(), 0);
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) // nothing to read on a non-blocking socket
+            return true;
+        return owner->on_data(buffer.data(), static_cast<int>(received));
+    };
+    add(fd, std::move(handler), reactor);
+}
+
+/**
+ * @brief Gives a listening socket to a reactor.
+ *
+ * @param fd The socket.
+ * @param on_accept Called with every accepted connection, or -1 if accepting failed.
+ * @param on_close Called when the reactors stop or an error is reported on the socket.
+ * @param reactor Index of the reactor (modulo count), by default reactors are used in turn.
+ */
+void Reactor::accept(int fd, std::function<void(int)> on_accept, std::function<void()> on_close, size_t reactor)
+{
+    auto handler = std::make_shared<Handler>();
+    handler->on_accept = std::move(on_accept);
+    handler->on_close = std::move(on_close);
+    const Handler *owner = handler.get();
+    handler->on_readable = [fd, owner]() {
+        int client = accept4(fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) // connection can be taken by another shard
+            owner->on_accept(client);
+        return true;
+    };
+    add(fd, std::move(handler), reactor);
+}
+
+/**
+ * @brief Registers the handler of a socket in a reactor.
+ *
+ * After stop was called the socket is closed instead (for example a connection accepted during the shutdown).
+ */
+void Reactor::add(int fd, std::shared_ptr<Handler> handler, size_t reactor)
+{
+    size_t reactorCount = count();
+    if (reactorCount == 0) // stopped before any socket was added
+    {
+        handler->on_close();
+        return;
+    }
+    if (reactor == static_cast<size_t>(-1))
+        reactor = next++;
+    Reactor &owner = *reactors[reactor % reactorCount];
+    bool accepted;
+    {
+        // stop sets stopping before it takes the handlers of the reactor under the same lock
+        std::lock_guard<std::mutex> lock(owner.mtx);
+        accepted = !stopping.load();
+        if (accepted)
+        {
+            owner.handlers[fd] = handler;
+#ifdef USE_IO_URING
+            if (owner.ring)
+            {
+                handler->id = next_id++;
+                owner.added.push_back({fd, handler});
+            }
+#endif
+        }
+    }
+    if (!accepted)
+    {
+        handler->on_close();
+        return;
+    }
+#ifdef USE_IO_URING
+    if (owner.ring)
+    {
+        uint64_t one = 1;
+        if (write(owner.wake_fd, &one, sizeof(one)) < 0)
+            std::cerr << "Reactor wake up error" << std::endl;
+        return;
+    }
+#endif
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    epoll_ctl(owner.epoll_fd, EPOLL_CTL_ADD, fd, &event);
+}
+
+/**
+ * @brief Forgets the handler of a socket (only if the number of the closed socket wasn't reused by a new socket).
+ */
+void Reactor::remove(int fd, const std::shared_ptr<Handler> &handler)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = handlers.find(fd);
+    if (it != handlers.end() && it->second == handler)
+        handlers.erase(it);
+}
+
+/**
+ * @brief Stops the reactors and closes every socket they own.
+ */
+void Reactor::stop()
+{
+    if (stopping.exchange(true))
+        return;
+    std::call_once(reactors_flag, []() {}); // waits for reactors started by another thread, none are started later
+    for (auto &reactor : reactors)
+    {
+        uint64_t one = 1;
+        if (write(reactor->wake_fd, &one, sizeof(one)) < 0)
+            std::cerr << "Reactor wake up error" << std::endl;
+    }
+    // No lock is held while joining, handlers of the reactors can still add sockets (they are closed by add)
+    for (auto &reactor : reactors)
+        reactor->thread.join();
+    for (auto &reactor : reactors)
+    {
+        std::unordered_map<int, std::shared_ptr<Handler>> owned;
+        {
+            std::lock_guard<std::mutex> lock(reactor->mtx);
+            owned.swap(reactor->handlers);
+        }
+        for (auto &handler : owned)
+            handler.second->on_close();
+    }
+}
+
+/**
+ * @brief Event loop of the reactor, ends when the wake up eventfd is written.
+ */
+void Reactor::run()
+{
+#ifdef USE_IO_URING
+    if (ring)
+    {
+        runRing();
+        return;
+    }
+#endif
+    const int MAX_EVENTS = 64;
+    epoll_event events[MAX_EVENTS];
+    while (true)
+    {
+        int ready = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+        if (ready < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            std::cerr << "Reactor epoll error" << std::endl;
+            return;
+        }
+        for (int i = 0; i < ready; ++i)
+        {
+            int fd = events[i].data.fd;
+            if (fd == wake_fd)
+                return;
+            std::shared_ptr<Handler> handler;
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                auto it = handlers.find(fd);
+                if (it == handlers.end())
+                    continue;
+                handler = it->second;
+            }
+            if (!handler->on_readable())
+                remove(fd, handler);
+            else if (events[i].events & EPOLLERR)
+            {
+                // A failed socket stays readable, so it is closed instead of being reported in a loop
+                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+                remove(fd, handler);
+                handler->on_close();
+            }
+        }
+    }
+}
+
+#ifdef USE_IO_URING
+/**
+ * @brief Writes the request of a socket into the submission ring: multishot accept or receive into provided buffers.
+ *
+ * The user data of the request is the socket and the id of its handler, so completions of a closed socket
+ * aren't given to the handler of a new socket with the same number.
+ */
+void Reactor::arm(int fd, const Handler &handler)
+{
+    io_uring_sqe *sqe = ring->sqe();
+    sqe->fd = fd;
+    sqe->user_data = static_cast<uint64_t>(handler.id) << 32 | static_cast<unsigned int>(fd);
+    if (handler.on_accept)
+    {
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_CLOEXEC;
+    }
+    else
+    {
+        sqe->opcode = IORING_OP_RECV;
+        sqe->ioprio = multishot ? IORING_RECV_MULTISHOT : 0;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = Uring::buffer_group;
+    }
+}
+
+/**
+ * @brief Event loop of the reactor with io_uring, ends when the wake up eventfd is written by stop.
+ *
+ * Requests of added sockets are submitted together with the wait for completions. A request which ended
+ * (no `IORING_CQE_F_MORE`), for example because every buffer was in use, is armed again.
+ */
+void Reactor::runRing()
+{
+    std::vector<std::pair<int, std::shared_ptr<Handler>>> arming;
+    bool wake_armed = false;
+    while (true)
+    {
+        if (!wake_armed)
+        {
+            io_uring_sqe *sqe = ring->sqe();
+            sqe->opcode = IORING_OP_POLL_ADD;
+            sqe->fd = wake_fd;
+            sqe->poll32_events = POLLIN;
+            sqe->user_data = 0;
+            wake_armed = true;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            arming.swap(added);
+        }
+        for (auto &socket : arming)
+            arm(socket.first, *socket.second);
+        arming.clear();
+        int result = ring->submit(1);
+        if (result < 0)
+        {
+            std::cerr << "Reactor io_uring error: " << strerror(-result) << std::endl;
+            return;
+        }
+        io_uring_cqe cqe;
+        while (ring->completion(cqe))
+        {
+            if (cqe.user_data == 0)
+            {
+                if (stopping.load())
+                    return;
+                uint64_t value;
+                if (read(wake_fd, &value, sizeof(value)) < 0 && errno != EAGAIN)
+                    std::cerr << "Reactor wake up error" << std::endl;
+                wake_armed = false; // sockets were added
+                continue;
+            }
+            int fd = static_cast<int>(cqe.user_data & 0xffffffff);
+            unsigned int id = static_cast<unsigned int>(cqe.user_data >> 32);
+            bool more = cqe.flags & IORING_CQE_F_MORE;
+            int buffer = (cqe.flags & IORING_CQE_F_BUFFER) ? static_cast<int>(cqe.flags >> IORING_CQE_BUFFER_SHIFT) : -1;
+            std::shared_ptr<Handler> handler;
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                auto it = handlers.find(fd);
+                if (it != handlers.end() && it->second->id == id)
+                    handler = it->second;
+            }
+            if (!handler)
+            {
+                if (buffer >= 0)
+                    ring->recycle(buffer);
+                continue;
+            }
+            if (handler->on_accept)
+            {
+                if (cqe.res != -EAGAIN)
+                    handler->on_accept(cqe.res >= 0 ? cqe.res : -1);
+                if (!more)
+                    arm(fd, *handler);
+                continue;
+            }
+            if (cqe.res == -ENOBUFS || (cqe.res == -EINVAL && multishot))
+            {
+                multishot = multishot && cqe.res != -EINVAL; // multishot receive needs Linux 6.0
+                arm(fd, *handler);
+                continue;
+            }
+            bool open = handler->on_data(buffer >= 0 ? ring->buffer(buffer) : "", cqe.res);
+            if (buffer >= 0)
+                ring->recycle(buffer);
+            if (!open)
+                remove(fd, handler);
+            else if (cqe.res < 0)
+            {
+                // A failed socket is closed instead of being reported in a loop
+                remove(fd, handler);
+                handler->on_close();
+            }
+            else if (!more)
+                arm(fd, *handler);
+        }
+    }
+}
+#endif
+#endif
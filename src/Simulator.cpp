@@ -0,0 +1,179 @@
+#include "../Objects/Simulator/simulator.hpp"
+
+std::mutex Simulator::mtx;
+std::priority_queue<Simulator::Task, std::vector<Simulator::Task>, std::greater<Simulator::Task>> Simulator::queue;
+unsigned long long Simulator::seq = 0;
+std::atomic<long long> Simulator::tick(0);
+long long Simulator::end = std::numeric_limits<long long>::max();
+std::unordered_map<std::string, std::vector<std::function<void()>>> Simulator::topics;
+std::map<std::tuple<bool, uint32_t, uint16_t>, std::function<void(const char *, int)>> Simulator::listeners;
+std::vector<std::pair<long long, std::string>> Simulator::environment;
+bool Simulator::enabled = false;
+long long Simulator::duration = 0;
+
+/**
+ * @brief Switches the emulator to virtual time (before components are created).
+ *
+ * The virtual clock starts at the actual steady clock time, so logs keep their usual time format.
+ */
+void Simulator::enable()
+{
+    tick.store(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    enabled = true;
+}
+
+long long Simulator::now() { return tick.load(std::memory_order_relaxed); }
+
+/**
+ * @brief Returns the actual time of the emulation (virtual in simulation mode, steady clock otherwise).
+ */
+std::chrono::steady_clock::time_point Simulator::steadyNow()
+{
+    if (!enabled)
+        return std::chrono::steady_clock::now();
+    return std::chrono::steady_clock::time_point(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(now())));
+}
+
+/**
+ * @brief Schedules a task at a virtual time (tasks in the past run at the actual time).
+ *
+ * @param at Virtual tick.
+ * @param task The task.
+ */
+void Simulator::schedule(long long at, std::function<void()> task)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    queue.push(Task{std::max(at, now()), seq++, std::move(task)});
+}
+
+/**
+ * @brief Sets MQTT messages published by the environment (there is no external broker in simulation mode).
+ *
+ * @param value Messages in the form `topic@seconds,...`, seconds after the start time (can be fractional).
+ * @return false if the value is invalid.
+ */
+bool Simulator::setEnvironment(const std::string &value)
+{
+    std::stringstream valueStream(value);
+    std::string message;
+    while (std::getline(valueStream, message, ',')) {
+        size_t separator = message.rfind('@');
+        if (separator == std::string::npos || separator == 0)
+            return false;
+        char *parsed_end;
+        double seconds = std::strtod(message.c_str() + separator + 1, &parsed_end);
+        if (*parsed_end != '\0' || seconds < 0)
+            return false;
+        environment.push_back({static_cast<long long>(seconds * 1e9), message.substr(0, separator)});
+    }
+    return true;
+}
+
+/**
+ * @brief Marks the start of the emulation (start time of components), it ends `duration` later.
+ *
+ * Called by every component when its client ports start, only the first call sets the end
+ * and schedules messages of the environment.
+ */
+void Simulator::startRun()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (end != std::numeric_limits<long long>::max())
+            return;
+        end = now() + duration;
+    }
+    for (auto &message : environment) {
+        std::string topic = message.second;
+        schedule(now() + message.first, [topic]() { publish(topic); });
+    }
+}
+
+/**
+ * @brief Runs scheduled tasks in time order until the queue is empty or the virtual time reaches the end.
+ *
+ * Tasks scheduled after the end are dropped (like pending timers at termination).
+ */
+void Simulator::run()
+{
+    while (true)
+    {
+        Task next;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (queue.empty() || queue.top().at > end)
+                break;
+            next = queue.top();
+            queue.pop();
+        }
+        tick.store(next.at, std::memory_order_relaxed);
+        next.task();
+    }
+    std::lock_guard<std::mutex> lock(mtx);
+    if (end != std::numeric_limits<long long>::max())
+        tick.store(end, std::memory_order_relaxed);
+    queue = decltype(queue)();
+}
+
+/**
+ * @brief Registers a receiver of an MQTT topic on the in-process bus.
+ */
+void Simulator::subscribe(const std::string &topic, std::function<void()> on_message)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    topics[topic].push_back(std::move(on_message));
+}
+
+/**
+ * @brief Delivers an MQTT message to every subscriber of the topic at the actual virtual time.
+ */
+void Simulator::publish(const std::string &topic)
+{
+    std::vector<std::function<void()>> receivers;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = topics.find(topic);
+        if (it == topics.end())
+            return;
+        receivers = it->second;
+    }
+    for (auto &receiver : receivers)
+        schedule(now(), receiver);
+}
+
+/**
+ * @brief Opens a server port of the in-memory transport.
+ *
+ * @param tcp Transport of the port.
+ * @param ip Local address (0.0.0.0 receives packets for every address).
+ * @param port Local port.
+ * @param on_packet Called with the content of every packet sent to the port.
+ */
+void Simulator::listen(bool tcp, const std::string &ip, int port, std::function<void(const char *, int)> on_packet)
+{
+    in_addr addr = {};
+    inet_pton(AF_INET, ip.c_str(), &addr);
+    std::lock_guard<std::mutex> lock(mtx);
+    listeners[std::make_tuple(tcp, static_cast<uint32_t>(addr.s_addr), static_cast<uint16_t>(port))] = std::move(on_packet);
+}
+
+/**
+ * @brief Sends a packet of the in-memory transport, it is received at once by the server port of the address.
+ *
+ * @return false if no server port has the address (the packet is lost).
+ */
+bool Simulator::send(bool tcp, const sockaddr_in &addr, const char *data, int size)
+{
+    std::function<void(const char *, int)> on_packet;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = listeners.find(std::make_tuple(tcp, static_cast<uint32_t>(addr.sin_addr.s_addr), ntohs(addr.sin_port)));
+        if (it == listeners.end())
+            it = listeners.find(std::make_tuple(tcp, static_cast<uint32_t>(INADDR_ANY), ntohs(addr.sin_port)));
+        if (it == listeners.end())
+            return false;
+        on_packet = it->second;
+    }
+    on_packet(data, size);
+    return true;
+}
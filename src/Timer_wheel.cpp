@@ -0,0 +1,174 @@
+#include "../Objects/Timer_wheel/timer_wheel.hpp"
+#include "../Objects/Simulator/simulator.hpp"
+
+std::vector<Timer_wheel::Timer> Timer_wheel::wheel[Timer_wheel::LEVELS][Timer_wheel::SLOTS];
+size_t Timer_wheel::pending = 0;
+long long Timer_wheel::current = 0;
+const std::chrono::steady_clock::time_point Timer_wheel::origin = std::chrono::steady_clock::now();
+std::thread Timer_wheel::timer_thread;
+std::mutex Timer_wheel::mtx;
+std::condition_variable Timer_wheel::cv;
+bool Timer_wheel::stopped = false;
+
+/**
+ * @brief Schedules a callback after a timeout.
+ *
+ * The callback is run on a thread of the `Executor` with true when the timer expires (not earlier than
+ * the timeout, at most 1 ms later), or on the thread calling `stop` with false when the timer is cancelled.
+ * After `stop` the callback is cancelled at once.
+ * In simulation mode the timer expires exactly after the timeout in virtual time (pending timers are dropped at the end).
+ *
+ * @param ms Timeout in milliseconds.
+ * @param callback The callback.
+ */
+void Timer_wheel::schedule(const unsigned long long &ms, std::function<void(bool)> callback)
+{
+    if (Simulator::enabled)
+    {
+        Simulator::schedule(Simulator::now() + static_cast<long long>(ms) * 1000000, [callback]() { callback(true); });
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mtx);
+    if (stopped)
+    {
+        lock.unlock();
+        callback(false);
+        return;
+    }
+    if (!timer_thread.joinable())
+        timer_thread = std::thread(&Timer_wheel::run);
+    // Round the actual time up to the next tick, so the timer never expires before the timeout
+    auto elapsed = std::chrono::steady_clock::now() - origin;
+    long long now = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+    if (std::chrono::milliseconds(now) < elapsed)
+        ++now;
+    long long expires = std::max(now + static_cast<long long>(ms), current + 1);
+    bool earlier = expires < nextTick();
+    insert(Timer{expires, std::move(callback)});
+    ++pending;
+    lock.unlock();
+    if (earlier)
+        cv.notify_one();
+}
+
+/**
+ * @brief Cancels every pending timer and stops the timer thread.
+ */
+void Timer_wheel::stop()
+{
+    std::vector<Timer> cancelled;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopped = true;
+    }
+    cv.notify_one();
+    if (timer_thread.joinable())
+        timer_thread.join();
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (auto &level : wheel)
+            for (auto &slot : level)
+            {
+                for (auto &timer : slot)
+                    cancelled.push_back(std::move(timer));
+                slot.clear();
+            }
+        pending = 0;
+    }
+    for (auto &timer : cancelled)
+        timer.callback(false);
+}
+
+/**
+ * @brief Puts a timer into the slot of the lowest level which covers its expiry.
+ */
+void Timer_wheel::insert(Timer &&timer)
+{
+    long long delta = timer.expires - current;
+    unsigned int level = 0;
+    while (level + 1 < LEVELS && delta >= (1LL << (SLOT_BITS * (level + 1))))
+        ++level;
+    // Timers after the range of the last level wait in its last slot, they are placed again on cascade
+    long long expires = std::min(timer.expires, current + (1LL << (SLOT_BITS * LEVELS)) - 1);
+    wheel[level][(expires >> (SLOT_BITS * level)) & (SLOTS - 1)].push_back(std::move(timer));
+}
+
+/**
+ * @brief Moves the wheel by one tick and collects expired timers.
+ *
+ * When a level wraps around, the timers of the next slot of the higher level are placed again.
+ */
+void Timer_wheel::advance(std::vector<Timer> &due)
+{
+    ++current;
+    for (unsigned int level = 1; level < LEVELS; ++level)
+    {
+        if ((current & ((1LL << (SLOT_BITS * level)) - 1)) != 0)
+            break;
+        std::vector<Timer> cascaded;
+        cascaded.swap(wheel[level][(current >> (SLOT_BITS * level)) & (SLOTS - 1)]);
+        for (auto &timer : cascaded)
+            insert(std::move(timer));
+    }
+    std::vector<Timer> &slot = wheel[0][current & (SLOTS - 1)];
+    std::vector<Timer> expired;
+    expired.swap(slot);
+    for (auto &timer : expired)
+    {
+        if (timer.expires <= current)
+        {
+            due.push_back(std::move(timer));
+            --pending;
+        }
+        else
+            insert(std::move(timer)); // clamped timer placed again
+    }
+    expired.clear();
+    if (slot.empty())
+        slot.swap(expired); // keep the memory of the slot
+}
+
+/**
+ * @brief Returns the tick when the thread has to wake up: the next non-empty slot of level 0,
+ * or the wrap of level 0 (timers of higher levels are moved down).
+ */
+long long Timer_wheel::nextTick()
+{
+    if (pending == 0)
+        return std::numeric_limits<long long>::max();
+    for (long long tick = current + 1; ; ++tick)
+        if (!wheel[0][tick & (SLOTS - 1)].empty() || (tick & (SLOTS - 1)) == 0)
+            return tick;
+}
+
+/**
+ * @brief Timer thread loop, expired callbacks are run on the executor so a long callback doesn't delay other timers.
+ */
+void Timer_wheel::run()
+{
+    std::vector<Timer> due;
+    std::unique_lock<std::mutex> lock(mtx);
+    while (!stopped)
+    {
+        long long now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - origin).count();
+        while (current < now)
+            advance(due);
+        if (!due.empty())
+        {
+            lock.unlock();
+            for (auto &timer : due)
+            {
+                std::function<void(bool)> callback = std::move(timer.callback);
+                Executor::submit([callback]() { callback(true); });
+            }
+            due.clear();
+            lock.lock();
+            continue;
+        }
+        long long next = nextTick();
+        if (next == std::numeric_limits<long long>::max())
+            cv.wait(lock);
+        else
+            cv.wait_until(lock, origin + std::chrono::milliseconds(next));
+    }
+}
@@ -0,0 +1,240 @@
+#include "../Objects/Trace/trace.hpp"
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+const size_t Trace::header_size;
+const size_t Trace::record_header_size;
+const size_t Trace::release_chunk;
+
+Trace::Trace() : data(nullptr), size(0), snaplen(0), linktype(0), swapped(false), nanoseconds(false)
+#ifdef _WIN32
+    , file(INVALID_HANDLE_VALUE), mapping(nullptr)
+#else
+    , fd(-1)
+#endif
+{
+}
+
+Trace::~Trace()
+{
+#ifdef _WIN32
+    if (data)
+        UnmapViewOfFile(data);
+    if (mapping)
+        CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE)
+        CloseHandle(file);
+#else
+    if (data)
+        munmap(const_cast<char *>(data), size);
+    if (fd >= 0)
+        close(fd);
+#endif
+}
+
+/**
+ * @brief Maps a capture file into memory and checks its header.
+ *
+ * Only the classic pcap format is read (microsecond or nanosecond timestamps, both byte orders).
+ *
+ * @param path Path of the capture.
+ * @param error Reason of the failure.
+ * @return The trace or nullptr if the file can't be read.
+ */
+std::shared_ptr<Trace> Trace::open(const std::string &path, std::string &error)
+{
+    std::shared_ptr<Trace> trace(new Trace());
+#ifdef _WIN32
+    trace->file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    LARGE_INTEGER fileSize;
+    if (trace->file == INVALID_HANDLE_VALUE || !GetFileSizeEx(trace->file, &fileSize))
+    {
+        error = "can't open " + path;
+        return nullptr;
+    }
+    trace->size = static_cast<size_t>(fileSize.QuadPart);
+    if (trace->size >= header_size)
+    {
+        trace->mapping = CreateFileMappingA(trace->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (trace->mapping)
+            trace->data = static_cast<const char *>(MapViewOfFile(trace->mapping, FILE_MAP_READ, 0, 0, 0));
+    }
+#else
+    trace->fd = ::open(path.c_str(), O_RDONLY);
+    struct stat fileStat;
+    if (trace->fd < 0 || fstat(trace->fd, &fileStat) != 0)
+    {
+        error = "can't open " + path;
+        return nullptr;
+    }
+    trace->size = static_cast<size_t>(fileStat.st_size);
+    if (trace->size >= header_size)
+    {
+        void *mapped = mmap(nullptr, trace->size, PROT_READ, MAP_PRIVATE, trace->fd, 0);
+        if (mapped != MAP_FAILED)
+        {
+            madvise(mapped, trace->size, MADV_SEQUENTIAL);
+            trace->data = static_cast<const char *>(mapped);
+        }
+    }
+#endif
+    if (!trace->data)
+    {
+        error = "can't map " + path + " (empty file?)";
+        return nullptr;
+    }
+    uint32_t magic;
+    std::memcpy(&magic, trace->data, sizeof(magic));
+    switch (magic)
+    {
+        case 0xa1b2c3d4: break;
+        case 0xa1b23c4d: trace->nanoseconds = true; break;
+        case 0xd4c3b2a1: trace->swapped = true; break;
+        case 0x4d3cb2a1: trace->swapped = trace->nanoseconds = true; break;
+        default:
+            error = path + " isn't a pcap file (pcapng isn't supported)";
+            return nullptr;
+    }
+    trace->snaplen = trace->read32(trace->data + 16);
+    trace->linktype = trace->read32(trace->data + 20) & 0x0FFFFFFF; // upper bits are FCS information
+    return trace;
+}
+
+uint32_t Trace::read32(const char *at) const
+{
+    uint32_t value;
+    std::memcpy(&value, at, sizeof(value));
+    if (swapped)
+        value = (value >> 24) | ((value >> 8) & 0xFF00) | ((value << 8) & 0xFF0000) | (value << 24);
+    return value;
+}
+
+/**
+ * @brief Finds the transport payload of a captured frame.
+ *
+ * Ethernet (with VLAN tags), Linux cooked (SLL, SLL2), BSD loopback and raw IP captures of IPv4 and IPv6
+ * are read, the payload of UDP and TCP packets is returned, of other IP packets the IP payload.
+ * Frames of other link types or protocols are returned whole.
+ *
+ * @param begin Start of the payload.
+ * @return Size of the payload.
+ */
+size_t Trace::payload(const char *frame, size_t length, const char *&begin) const
+{
+    auto byte = [frame](size_t at) { return static_cast<unsigned int>(static_cast<unsigned char>(frame[at])); };
+    auto be16 = [&byte](size_t at) { return byte(at) << 8 | byte(at + 1); };
+    begin = frame;
+    size_t offset = 0;
+    unsigned int protocol = 0; // EtherType of the network layer
+    switch (linktype)
+    {
+        case 1: // Ethernet
+            if (length < 14)
+                return length;
+            offset = 14;
+            protocol = be16(12);
+            while ((protocol == 0x8100 || protocol == 0x88a8) && length >= offset + 4)
+            {
+                protocol = be16(offset + 2);
+                offset += 4;
+            }
+            break;
+        case 113: // Linux cooked
+            if (length < 16)
+                return length;
+            offset = 16;
+            protocol = be16(14);
+            break;
+        case 276: // Linux cooked v2
+            if (length < 20)
+                return length;
+            offset = 20;
+            protocol = be16(0);
+            break;
+        case 0: // BSD loopback, address family in the byte order of the capturing host
+        {
+            if (length < 4)
+                return length;
+            offset = 4;
+            uint32_t family = read32(frame);
+            protocol = family == 2 ? 0x0800 : (family == 24 || family == 28 || family == 30) ? 0x86DD : 0;
+            break;
+        }
+        case 12: case 101: case 228: case 229: // raw IP
+            if (length < 1)
+                return length;
+            protocol = (byte(0) >> 4) == 4 ? 0x0800 : (byte(0) >> 4) == 6 ? 0x86DD : 0;
+            break;
+        default:
+            return length;
+    }
+
+    size_t ip_header, end;
+    unsigned int transport;
+    if (protocol == 0x0800 && length >= offset + 20)
+    {
+        ip_header = (byte(offset) & 0x0F) * 4;
+        end = be16(offset + 2);
+        transport = byte(offset + 9);
+    }
+    else if (protocol == 0x86DD && length >= offset + 40)
+    {
+        ip_header = 40;
+        end = 40 + be16(offset + 4);
+        transport = byte(offset + 6);
+    }
+    else
+        return length;
+    end = std::min(end, length - offset); // Ethernet padding, packets cut by the snap length
+    size_t transport_header = 0;
+    if (transport == 17) // UDP
+        transport_header = 8;
+    else if (transport == 6 && end >= ip_header + 13) // TCP
+        transport_header = (byte(offset + ip_header + 12) >> 4) * 4;
+    if (ip_header + transport_header > end)
+        return length;
+    begin = frame + offset + ip_header + transport_header;
+    return end - ip_header - transport_header;
+}
+
+/**
+ * @brief Reads the record at the position and moves the position to the next one.
+ *
+ * Records without payload (for example TCP acknowledgements) are skipped. When the position passes
+ * a `release_chunk` boundary, pages of the passed chunk are dropped from the mapping (they are read again
+ * from the file if another port still needs them).
+ *
+ * @param pos Offset of the record in the file (`header_size` for the first one).
+ * @return false at the end of the capture (or at a truncated record).
+ */
+bool Trace::next(size_t &pos, Record &record) const
+{
+    while (pos + record_header_size <= size)
+    {
+        const char *header = data + pos;
+        size_t length = read32(header + 8);
+        if (length > size - pos - record_header_size)
+            return false;
+        size_t previous = pos;
+        pos += record_header_size + length;
+        if (previous / release_chunk != pos / release_chunk)
+            release(previous / release_chunk * release_chunk, pos / release_chunk * release_chunk);
+        record.size = payload(header + record_header_size, length, record.data);
+        if (record.size == 0)
+            continue;
+        record.ts = static_cast<long long>(read32(header)) * 1000000000LL + static_cast<long long>(read32(header + 4)) * (nanoseconds ? 1 : 1000);
+        return true;
+    }
+    return false;
+}
+
+void Trace::release(size_t from, size_t to) const
+{
+#ifndef _WIN32
+    madvise(const_cast<char *>(data) + from, to - from, MADV_DONTNEED);
+#endif
+}
+
+size_t Trace::getSnaplen() const { return snaplen; }
@@ -0,0 +1,224 @@
+#include "../Objects/Uring/uring.hpp"
+
+#if defined(__linux__) && defined(USE_IO_URING)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup 425
+#define __NR_io_uring_enter 426
+#define __NR_io_uring_register 427
+#endif
+
+bool Uring::enabled = true;
+std::once_flag Uring::probe_flag;
+bool Uring::usable = false;
+const unsigned short Uring::buffer_group;
+
+Uring::Uring() : ring_fd(-1), sq_ptr(MAP_FAILED), cq_ptr(MAP_FAILED), sq_size(0), cq_size(0), sqes(static_cast<io_uring_sqe *>(MAP_FAILED)),
+                 sq_entries(0), local_tail(0), queued(0), buf_ring(nullptr), buf_count(0), buf_size(0), buf_tail(0), inflight(0)
+{
+}
+
+Uring::~Uring()
+{
+    if (sqes != MAP_FAILED)
+        munmap(sqes, sq_entries * sizeof(io_uring_sqe));
+    if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr)
+        munmap(cq_ptr, cq_size);
+    if (sq_ptr != MAP_FAILED)
+        munmap(sq_ptr, sq_size);
+    if (ring_fd >= 0)
+        close(ring_fd); // cancels requests which are still armed
+    free(buf_ring);
+}
+
+/**
+ * @brief Checks once whether io_uring can be used (selected and supported by the kernel).
+ *
+ * The kernel has to support the operations used by the reactors and pacing threads and rings of provided buffers
+ * (Linux 5.19+). Otherwise the reason is printed and sockets use system calls (epoll, sendmsg).
+ */
+bool Uring::available()
+{
+    std::call_once(probe_flag, []() {
+        if (!enabled)
+            return;
+        Uring ring;
+        std::string error;
+        if (ring.init(8, error))
+        {
+            std::vector<char> memory(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op));
+            io_uring_probe *probe = reinterpret_cast<io_uring_probe *>(memory.data());
+            if (syscall(__NR_io_uring_register, ring.ring_fd, IORING_REGISTER_PROBE, probe, 256) < 0)
+                error = std::string("probe: ") + strerror(errno);
+            else
+                for (unsigned op : {IORING_OP_RECV, IORING_OP_ACCEPT, IORING_OP_SENDMSG, IORING_OP_POLL_ADD})
+                    if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED))
+                        error = "operation " + std::to_string(op) + " is not supported";
+        }
+        if (error.empty())
+            ring.provideBuffers(8, 64, error);
+        usable = error.empty();
+        if (!usable)
+            std::cerr << "io_uring is not available (" << error << "), sockets use system calls" << std::endl;
+    });
+    return enabled && usable;
+}
+
+/**
+ * @brief Creates the rings and maps them into memory.
+ *
+ * @param entries Size of the submission ring (the completion ring is twice as large).
+ * @param error Reason of a failure.
+ * @return false on error.
+ */
+bool Uring::init(unsigned entries, std::string &error)
+{
+    io_uring_params params = {};
+    ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (ring_fd < 0)
+    {
+        error = std::string("setup: ") + strerror(errno);
+        return false;
+    }
+    sq_entries = params.sq_entries;
+    sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap)
+        sq_size = cq_size = std::max(sq_size, cq_size);
+    sq_ptr = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if (sq_ptr == MAP_FAILED)
+    {
+        error = std::string("mmap: ") + strerror(errno);
+        return false;
+    }
+    cq_ptr = single_mmap ? sq_ptr : mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+    sqes = static_cast<io_uring_sqe *>(mmap(nullptr, sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES));
+    if (cq_ptr == MAP_FAILED || sqes == MAP_FAILED)
+    {
+        error = std::string("mmap: ") + strerror(errno);
+        return false;
+    }
+    char *sq = static_cast<char *>(sq_ptr), *cq = static_cast<char *>(cq_ptr);
+    sq_head = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sq_mask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cq_mask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+    local_tail = *sq_tail;
+    return true;
+}
+
+/**
+ * @brief Registers a ring of receive buffers (group `buffer_group`) in the kernel.
+ *
+ * A multishot receive takes a free buffer for every completion (its id is in the flags of the completion),
+ * the buffer is given back by `recycle` when its data was handled.
+ *
+ * @param count Number of buffers (a power of 2).
+ * @param size Size of a buffer, longer datagrams are truncated.
+ * @param error Reason of a failure.
+ * @return false on error.
+ */
+bool Uring::provideBuffers(unsigned count, unsigned size, std::string &error)
+{
+    void *memory = nullptr;
+    if (posix_memalign(&memory, static_cast<size_t>(sysconf(_SC_PAGESIZE)), count * sizeof(io_uring_buf)) != 0)
+    {
+        error = "buffer ring: out of memory";
+        return false;
+    }
+    std::memset(memory, 0, count * sizeof(io_uring_buf));
+    buf_ring = static_cast<io_uring_buf_ring *>(memory);
+    io_uring_buf_reg reg = {};
+    reg.ring_addr = reinterpret_cast<unsigned long long>(memory);
+    reg.ring_entries = count;
+    reg.bgid = buffer_group;
+    if (syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+    {
+        error = std::string("buffer ring: ") + strerror(errno);
+        return false;
+    }
+    buffers.resize(static_cast<size_t>(count) * size);
+    buf_count = count;
+    buf_size = size;
+    for (unsigned id = 0; id < count; ++id)
+        recycle(id);
+    return true;
+}
+
+/**
+ * @brief Gives a buffer back to the kernel.
+ */
+void Uring::recycle(unsigned id)
+{
+    // Entries start at the ring (`bufs` of the kernel header is moved by an empty struct in C++), the tail overlays the first one
+    io_uring_buf &buf = reinterpret_cast<io_uring_buf *>(buf_ring)[buf_tail & (buf_count - 1)];
+    buf.addr = reinterpret_cast<unsigned long long>(buffer(id));
+    buf.len = buf_size;
+    buf.bid = static_cast<unsigned short>(id);
+    __atomic_store_n(&buf_ring->tail, ++buf_tail, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Returns a cleared entry of the submission ring, it is submitted by the next `submit`.
+ *
+ * If the ring is full, the entries written before are submitted first.
+ */
+io_uring_sqe *Uring::sqe()
+{
+    if (local_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= sq_entries)
+        submit(0);
+    unsigned index = local_tail & *sq_mask;
+    io_uring_sqe *entry = &sqes[index];
+    std::memset(entry, 0, sizeof(*entry));
+    sq_array[index] = index;
+    ++local_tail;
+    ++queued;
+    return entry;
+}
+
+/**
+ * @brief Submits written entries and waits for completions.
+ *
+ * @param wait Number of completions to wait for (0 - don't wait).
+ * @return Number of submitted entries or -errno.
+ */
+int Uring::submit(unsigned wait)
+{
+    __atomic_store_n(sq_tail, local_tail, __ATOMIC_RELEASE);
+    while (true)
+    {
+        long result = syscall(__NR_io_uring_enter, ring_fd, queued, wait, wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+        if (result >= 0)
+        {
+            queued -= std::min(queued, static_cast<unsigned>(result));
+            return static_cast<int>(result);
+        }
+        if (errno != EINTR)
+            return -errno;
+        // Interrupted while waiting, entries were submitted (they are no longer in the ring)
+        queued = local_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    }
+}
+
+/**
+ * @brief Takes the next completion without waiting.
+ *
+ * @return false if the completion ring is empty.
+ */
+bool Uring::completion(io_uring_cqe &cqe)
+{
+    unsigned head = *cq_head;
+    if (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE))
+        return false;
+    cqe = cqes[head & *cq_mask];
+    __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+#endif
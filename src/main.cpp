@@ -1,6 +1,6 @@
 #include "../Headers/helper_functions.hpp"
 #include "../Objects/ComponentFactory/ComponentFactory.hpp"
-#include "../Objects/Comp_log/comp_log.hpp"
+#include "../Objects/Comp_log/log_writer.hpp"
 using namespace std;
 
 /**
@@ -184,10 +184,7 @@ bool startEmulation(long seconds){
     {
             auto compPtr = comp.second;
             compPtr->subscribeEvents();
-        {
-            std::lock_guard<std::mutex> lock(compPtr->fut_mtx);
-            compPtr->futures.push_back(std::async(std::launch::async, &Component::startFlow, compPtr,time));
-        }
+        Executor::submit([compPtr, time]() { compPtr->startFlow(time); });
     }
     return true;
 }
@@ -197,10 +194,7 @@ bool startEmulation(std::string time){
         {
                 auto compPtr = comp.second;
                 compPtr->subscribeEvents();
-            {
-                std::lock_guard<std::mutex> lock(compPtr->fut_mtx);
-                compPtr->futures.push_back(std::async(std::launch::async, &Component::startFlow, compPtr,time));
-            }
+            Executor::submit([compPtr, time]() { compPtr->startFlow(time); });
         } 
         return true; 
     }else{
@@ -208,6 +202,34 @@ bool startEmulation(std::string time){
         return false;
     }
 }
+/**
+ * @brief Ends the emulation: wakes up every component, disconnects MQTT clients and waits for every task.
+ */
+void stopEmulation(){
+    Component::terminate(); // wakes up every waiting port and component
+
+    for (auto &comp : Component::cnames_components)
+    {
+        if (comp.second->client_.is_connected())
+            try
+            {
+                comp.second->client_.disconnect()->wait();
+            }
+            catch(const std::exception& exc)
+            {
+                std::cerr << "Disconnect error: " << exc.what() << std::endl;
+            }
+    }
+    // Cancel pending local events and wait for every task of components (ports, fired local events)
+    Timer_wheel::stop();
+    Flow_scheduler::stop(); // Close client ports
+    #ifdef __linux__
+        Reactor::stop(); // Close server ports
+    #endif
+    Executor::stop();
+    for (auto &comp : Component::cnames_components)
+        comp.second->printMailboxStats();
+}
 void createComponent(const std::vector<std::string>&  normalised_rcr){
     //Extract component information for logs
     std::string c_name = Helper_functions::getTokenAtIndex(normalised_rcr.at(0),0);
@@ -239,12 +261,63 @@ int main(int argc, char const *argv[])
         return -1;
     }    
     std::string path = argv[2];
+    // Optional arguments in form: --option value
+    size_t log_memory = 64; // MB of logs waiting for the writer
+    for (int i = 3; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        if (option == "--log-memory")
+            log_memory = std::strtoul(argv[i + 1], nullptr, 10);
+        else if (option == "--log-filter") {
+            if (!Comp_log::setFilter(argv[i + 1]))
+                std::cerr << "INVALID LOG FILTER " << argv[i + 1] << std::endl;
+        }
+#ifdef __linux__
+        else if (option == "--reuseport")
+            Reactor::reuseport = std::string(argv[i + 1]) == "on";
+#endif
+#ifdef USE_IO_URING
+        else if (option == "--io-uring")
+            Uring::enabled = std::string(argv[i + 1]) != "off";
+#endif
+        else if (option == "--pacers")
+            Flow_scheduler::pacer_count = std::max(1ul, std::strtoul(argv[i + 1], nullptr, 10));
+        else if (option == "--pacer-spin")
+            Flow_scheduler::spin = std::chrono::microseconds(std::strtoul(argv[i + 1], nullptr, 10));
+        else if (option == "--udp-batch")
+            Flow_scheduler::batch_window = std::chrono::microseconds(std::strtoul(argv[i + 1], nullptr, 10));
+#ifdef __linux__
+        else if (option == "--zerocopy")
+            Flow_scheduler::zerocopy_min = std::strtoul(argv[i + 1], nullptr, 10);
+        else if (option == "--pin-pacers")
+            Flow_scheduler::pin = std::string(argv[i + 1]) == "on";
+#endif
+        else if (option == "--trace")
+            Log_writer::trace_path = argv[i + 1];
+        else if (option == "--sim") {
+            Simulator::duration = std::strtoll(argv[i + 1], nullptr, 10) * 1000000000LL;
+            Simulator::enable();
+        }
+        else if (option == "--sim-env") {
+            if (!Simulator::setEnvironment(argv[i + 1]))
+                std::cerr << "INVALID SIMULATION ENVIRONMENT " << argv[i + 1] << std::endl;
+        }
+        else if (option == "--log-time")
+            Log_writer::time_format = std::string(argv[i + 1]) == "epoch" ? Time_format::epoch_ns : Time_format::hms;
+        else
+            std::cerr << "UNKNOWN OPTION " << option << std::endl;
+    }
 
+    if (!Component::initWakeup()) {
+        std::cerr << "CANNOT CREATE WAKE UP DESCRIPTOR" << std::endl;
+        return -1;
+    }
     std::vector<std::string> rcrs = readRCRFileContents(path);
     if (rcrs.size()==0){
         std::cout<<"NO RCR FILES IN FOLDER"<<std::endl;
         return -1;
     }else{
+        if (!Log_writer::start("output.txt", log_memory * 1024 * 1024))
+            return -1;
         vector<string> normalisedRCR;
         for (auto& rcr: rcrs)
         {
@@ -259,66 +332,21 @@ int main(int argc, char const *argv[])
         isemulationStart=startEmulation(std::strtoul(arg.c_str(), nullptr, 10));
     else 
         isemulationStart=startEmulation(arg);
-    while (isemulationStart)
+    if (isemulationStart && Simulator::enabled)
+    {
+        // The whole run is simulated at once, then the emulation ends like after 'q'
+        Simulator::run();
+        stopEmulation();
+    }
+    while (isemulationStart && !Simulator::enabled)
     {
         if (std::cin.get() == 'q')
         {
-            Component::terminateFlag.store(true);
-            Component::comp_cv.notify_all();
-
-            for (auto &comp : Component::cnames_components)
-            {
-                for (auto &fsm :comp.second->mnames_fsms)
-                    fsm.second->cv.notify_all();
-                if (comp.second->client_.is_connected())
-                    try
-                    {
-                        comp.second->client_.disconnect()->wait();
-                    }
-                    catch(const std::exception& exc)
-                    {
-                        std::cerr << "Disconnect error: " << exc.what() << std::endl;
-                    }
-                    std::lock_guard<std::mutex> lock(comp.second->fut_mtx);
-                    for (auto &thread : comp.second->futures){
-                        thread.get();
-                    }
-            }
-            for (auto &log_be : Comp_log::full_logs)
-            {
-                if (log_be->ph_value==BE && log_be->end.empty())
-                    log_be->end = Comp_log::getFormattedTime(std::chrono::system_clock::now());
-
-            }
-            std::ofstream outputFile("output.txt");
-
-            if (!outputFile.is_open())
-                std::cerr << "Unable to open file!" << std::endl;
-
-            for (auto &a : Comp_log::full_logs)
-            {
-                outputFile << "name: " << a->name << std::endl;
-                outputFile << "ts: " << a->ts << std::endl;
-                outputFile << "pid: " << a->pid << std::endl;
-
-                outputFile << "cat: ";
-                for (const auto &catValue : a->cat)
-                    outputFile << catValue << " ";
-                outputFile << std::endl;
-
-                outputFile << "args: ";
-                for (const auto &argValue : a->args)
-                    outputFile << argValue << " ";
-                outputFile << std::endl;
-
-                outputFile << "end: " << a->end << std::endl;
-                outputFile << std::endl;
-            }
-
-            outputFile.close();
+            stopEmulation();
             break;
         }
     };
+    Log_writer::stop();
 
     return 0;
 }
\ No newline at end of file